@@ -0,0 +1,221 @@
+/*
+ * \brief  Drain the frame-capture ring of a NIC driver into a pcap file
+ * \author agent
+ * \date   2026-10-16
+ *
+ * The capture ring is obtained as 'capture' ROM module from the driver and
+ * polled every 'interval_ms'. Records are appended to 'file' in the classic
+ * pcap format with Ethernet link type. Timestamps are relative to the start
+ * of the component, the tick rate of 'Trace::timestamp' is calibrated against
+ * the timer at startup. The component is meant to run at low priority, the
+ * driver never waits for it.
+ *
+ * Configuration:
+ *
+ * ! <config file="/capture.pcap" direction="both" interval_ms="100">
+ * !   <vfs> ... </vfs>
+ * ! </config>
+ *
+ * The 'direction' attribute selects "rx", "tx", or "both" directions.
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#include <base/attached_rom_dataspace.h>
+#include <base/component.h>
+#include <base/heap.h>
+#include <base/log.h>
+#include <os/vfs.h>
+#include <timer_session/connection.h>
+#include <trace/timestamp.h>
+
+/* local includes */
+#include <capture.h>
+
+using namespace Genode;
+
+namespace Nic_capture { struct Main; }
+
+
+struct Nic_capture::Main
+{
+	struct Pcap_header
+	{
+		uint32_t magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		int32_t  thiszone;
+		uint32_t sigfigs;
+		uint32_t snaplen;
+		uint32_t network;
+	} __attribute__((packed));
+
+	struct Pcap_record
+	{
+		uint32_t ts_sec;
+		uint32_t ts_usec;
+		uint32_t incl_len;
+		uint32_t orig_len;
+	} __attribute__((packed));
+
+	enum : uint32_t { PCAP_MAGIC_US = 0xa1b2c3d4, LINKTYPE_ETHERNET = 1 };
+
+	enum class Direction { RX, TX, BOTH };
+
+	Env &_env;
+
+	Attached_rom_dataspace _config      { _env, "config" };
+	Attached_rom_dataspace _capture_rom { _env, "capture" };
+	Timer::Connection      _timer       { _env };
+	Heap                   _heap        { _env.ram(), _env.rm() };
+
+	Direction const _direction { _read_direction(_config.node()) };
+
+	static Direction _read_direction(Node const &config)
+	{
+		using Name = String<8>;
+
+		Name const name = config.attribute_value("direction", Name("both"));
+
+		return (name == "rx") ? Direction::RX
+		     : (name == "tx") ? Direction::TX
+		     :                  Direction::BOTH;
+	}
+
+	uint64_t _now_us() { return _timer.curr_time().trunc_to_plain_us().value; }
+
+	/*
+	 * Ticks of 'Trace::timestamp' per second
+	 *
+	 * The rate is not a whole number of ticks per microsecond on every
+	 * board, e.g., the timestamp of MiG-V counts at 32 kHz.
+	 */
+	uint64_t _calibrate()
+	{
+		uint64_t          const us    = _now_us();
+		Trace::Timestamp  const ticks = Trace::timestamp();
+
+		_timer.msleep(100);
+
+		uint64_t const elapsed_us = _now_us() - us;
+
+		return max((uint64_t)(Trace::timestamp() - ticks) * 1000 * 1000
+		           / max(elapsed_us, (uint64_t)1), (uint64_t)1);
+	}
+
+	uint64_t         const _ticks_per_s { _calibrate() };
+	Trace::Timestamp const _start        { Trace::timestamp() };
+
+	Constructible<Root_directory>  _root_dir { };
+	Constructible<New_file>        _file     { };
+	Constructible<Capture::Reader> _reader   { };
+
+	/* the captured length of a record is 16 bit */
+	char _frame[1 << 16] { };
+
+	uint64_t _frames   { 0 };
+	uint64_t _overruns { 0 };
+
+	bool _append(void const *data, size_t const size)
+	{
+		if (_file->append((char const *)data, size) == New_file::Append_result::OK)
+			return true;
+
+		error("writing capture file failed");
+		return false;
+	}
+
+	void _drain(Duration)
+	{
+		uint64_t const frames = _frames;
+
+		_reader->for_each_record(_frame, [&] (Capture::Record const &record,
+		                                      void const *frame) {
+
+			bool const tx = record.direction() == Capture::Direction::TX;
+			if ((_direction == Direction::RX && tx) || (_direction == Direction::TX && !tx))
+				return;
+
+			uint64_t const ticks = (record.timestamp > _start)
+			                     ? record.timestamp - _start : 0;
+
+			Pcap_record const pcap {
+				.ts_sec   = (uint32_t)(ticks / _ticks_per_s),
+				.ts_usec  = (uint32_t)(ticks % _ticks_per_s * 1000 * 1000 / _ticks_per_s),
+				.incl_len = record.captured,
+				.orig_len = record.length };
+
+			if (_append(&pcap, sizeof(pcap)))
+				_append(frame, record.captured);
+
+			_frames++;
+		});
+
+		if (_reader->overruns != _overruns) {
+			warning("capture ring overrun, frames were lost (",
+			        _reader->overruns - _overruns, " times)");
+			_overruns = _reader->overruns;
+		}
+
+		if (_frames / 1000 != frames / 1000)
+			log("captured ", _frames, " frames");
+	}
+
+	Constructible<Timer::Periodic_timeout<Main>> _drain_timeout { };
+
+	Main(Env &env) : _env(env)
+	{
+		void const * const ring = _capture_rom.local_addr<void>();
+
+		if (!Capture::Reader::valid(ring)) {
+			error("'capture' ROM is not a capture ring");
+			return;
+		}
+
+		Node const &config = _config.node();
+
+		config.with_sub_node("vfs",
+			[&] (Node const &vfs) { _root_dir.construct(_env, _heap, vfs); },
+			[&] { error("missing <vfs> config"); });
+
+		if (!_root_dir.constructed())
+			return;
+
+		Directory::Path const path =
+			config.attribute_value("file", Directory::Path("/capture.pcap"));
+
+		_file.construct(*_root_dir, path);
+		_reader.construct(ring);
+
+		Pcap_header const header {
+			.magic         = PCAP_MAGIC_US,
+			.version_major = 2,
+			.version_minor = 4,
+			.thiszone      = 0,
+			.sigfigs       = 0,
+			.snaplen       = (uint32_t)_reader->snaplen(),
+			.network       = LINKTYPE_ETHERNET };
+
+		if (!_append(&header, sizeof(header)))
+			return;
+
+		uint64_t const interval_ms =
+			max(config.attribute_value("interval_ms", (uint64_t)100), (uint64_t)1);
+
+		_drain_timeout.construct(_timer, *this, &Main::_drain,
+		                         Microseconds(interval_ms * 1000));
+
+		log("capturing into ", path, ", ", _ticks_per_s, " ticks/s");
+	}
+};
+
+
+void Component::construct(Genode::Env &env)
+{
+	static Nic_capture::Main main(env);
+}
@@ -0,0 +1,7 @@
+TARGET = nic_capture
+SRC_CC = main.cc
+LIBS   = base vfs
+
+INC_DIR += $(REP_DIR)/src/driver/nic/opencores
+
+vpath %.cc $(PRG_DIR)
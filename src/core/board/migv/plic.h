@@ -18,7 +18,7 @@ namespace Board { class Plic; }
 
 struct Board::Plic : Genode::Mmio<0x30>
 {
-		enum { NR_OF_IRQ = 24 };
+		enum { NR_OF_IRQ = 24, MAX_PRIORITY = 15 };
 
 		struct El       : Register_array<0x8, 32, NR_OF_IRQ, 1>  { };
 		struct Priority : Register_array<0xc, 32, NR_OF_IRQ, 4>  { };
@@ -29,9 +29,18 @@ struct Board::Plic : Genode::Mmio<0x30>
 		:
 			Mmio(range)
 		{
-			/* set all priorities to 1 */
-			for (unsigned i = 0; i < NR_OF_IRQ; i++)
-				write<Priority>(1, i);
+			for (unsigned irq = 1; irq <= NR_OF_IRQ; irq++)
+				priority(Hw::Riscv_board::irq_priority(irq), irq);
+		}
+
+		/**
+		 * Set priority of 'irq', there is no threshold on MIG-V
+		 */
+		void priority(unsigned value, unsigned irq)
+		{
+			if (irq == 0 || irq > NR_OF_IRQ) return;
+
+			write<Priority>(Genode::min(value, (unsigned)MAX_PRIORITY), irq - 1);
 		}
 
 		void enable(unsigned value, unsigned irq)
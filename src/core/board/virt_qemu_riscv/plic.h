@@ -16,45 +16,117 @@
 
 namespace Board { class Plic; }
 
-struct Board::Plic : Genode::Mmio<0x200000 + 0x1 + 0x1000 + 0x4 + 4>
+struct Board::Plic : Genode::Mmio<Hw::Riscv_board::PLIC_SIZE>
 {
 		enum {
 			/*
 			 * VIRT_IRQCHIP_NUM_SOURCES from Qemu include/hw/riscv/virt.h.
 			 */
 			NR_OF_IRQ = 96,
+
+			NR_OF_HARTS = Hw::Riscv_board::PLIC_HARTS,
+
+			/* VIRT_IRQCHIP_NUM_PRIO_BITS is 3 */
+			MAX_PRIORITY = 7,
 		};
 
 		/*
-		 * Single core Qemu virt machine uses context 1 for
-		 * supervisor mode interrupts and 0 for machine mode.
+		 * The Qemu virt machine provides two contexts per hart, the even one
+		 * for machine mode and the odd one for supervisor mode interrupts.
 		 */
-		static constexpr Genode::size_t CONTEXT        = 0x1;
+		static constexpr Genode::size_t NR_OF_CONTEXTS = 2 * NR_OF_HARTS;
 		static constexpr Genode::addr_t ENABLE_BASE    = 0x2000;
 		static constexpr Genode::size_t ENABLE_STRIDE  = 0x80;
 		static constexpr Genode::addr_t CONTEXT_BASE   = 0x200000;
 		static constexpr Genode::size_t CONTEXT_STRIDE = 0x1000;
-		static constexpr Genode::addr_t ENABLE_ADDR    = ENABLE_BASE + CONTEXT * ENABLE_STRIDE;
-		static constexpr Genode::addr_t PRI_THR_ADDR   = CONTEXT_BASE + CONTEXT * CONTEXT_STRIDE;
-		static constexpr Genode::addr_t ID_ADDR        = CONTEXT_BASE + CONTEXT * CONTEXT_STRIDE + 0x4;
 
-		struct Priority           : Register_array<0x4, 32, NR_OF_IRQ - 1, 32> { };
-		struct Enable             : Register_array<ENABLE_ADDR, 32, NR_OF_IRQ, 1> { };
-		struct Priority_threshold : Register<PRI_THR_ADDR, 32> { };
-		struct Id                 : Register<ID_ADDR, 32> { };
+		static constexpr unsigned context(unsigned hart) { return 2 * hart + 1; }
+
+		/* index of the first enable bit and context register of 'hart' */
+		static constexpr unsigned enable_index(unsigned hart) {
+			return context(hart) * ENABLE_STRIDE * 8; }
+
+		static constexpr unsigned context_index(unsigned hart) {
+			return context(hart) * CONTEXT_STRIDE / 4; }
+
+		struct Priority  : Register_array<0x4, 32, NR_OF_IRQ - 1, 32> { };
+		struct Enable    : Register_array<ENABLE_BASE, 32,
+		                                  NR_OF_CONTEXTS * ENABLE_STRIDE * 8, 1> { };
+		struct Threshold : Register_array<CONTEXT_BASE, 32,
+		                                  NR_OF_CONTEXTS * CONTEXT_STRIDE / 4, 32> { };
+
+		/*
+		 * Claim/complete register of the boot hart
+		 */
+		struct Id : Register<CONTEXT_BASE + 0x1 * CONTEXT_STRIDE + 0x4, 32> { };
+
+		static_assert(CONTEXT_BASE + NR_OF_CONTEXTS * CONTEXT_STRIDE
+		              <= Hw::Riscv_board::PLIC_SIZE, "PLIC mapping too small");
+
+	private:
+
+		/* hart an interrupt is routed to */
+		unsigned char _affinity[NR_OF_IRQ] { };
+
+	public:
 
 		Plic(Genode::Byte_range_ptr const &range)
 		:
 			Mmio(range)
 		{
-			write<Priority_threshold>(0);
-			for (unsigned i = 0; i < NR_OF_IRQ - 1; ++i)
-				write<Priority>(1, i);
+			for (unsigned hart = 0; hart < Hw::Riscv_board::NR_OF_CPUS; hart++)
+				threshold(Hw::Riscv_board::PLIC_THRESHOLD, hart);
+
+			for (unsigned irq = 1; irq < NR_OF_IRQ; irq++)
+				priority(Hw::Riscv_board::irq_priority(irq), irq);
 		}
 
-		void enable(unsigned value, unsigned irq)
+		/**
+		 * Set priority of 'irq', 0 disables the source
+		 */
+		void priority(unsigned value, unsigned irq)
 		{
-			write<Enable>(value, irq);
+			if (irq == 0 || irq >= NR_OF_IRQ) return;
+
+			write<Priority>(Genode::min(value, (unsigned)MAX_PRIORITY), irq - 1);
+		}
+
+		/**
+		 * Mask all interrupts with a priority not above 'value' at 'hart'
+		 */
+		void threshold(unsigned value, unsigned hart)
+		{
+			if (hart >= NR_OF_HARTS) return;
+
+			write<Threshold>(Genode::min(value, (unsigned)MAX_PRIORITY),
+			                 context_index(hart));
+		}
+
+		/**
+		 * Enable or disable 'irq' at the supervisor context of 'hart'
+		 *
+		 * An interrupt is enabled at one hart only, enabling it at another
+		 * hart moves it there. Disabling applies to the hart the interrupt
+		 * is routed to, regardless of 'hart'.
+		 */
+		void enable(unsigned value, unsigned irq, unsigned hart = 0)
+		{
+			if (irq >= NR_OF_IRQ) return;
+
+			unsigned const current = _affinity[irq];
+
+			if (!value) {
+				write<Enable>(0, enable_index(current) + irq);
+				return;
+			}
+
+			if (hart >= Hw::Riscv_board::NR_OF_CPUS) hart = 0;
+
+			if (current != hart)
+				write<Enable>(0, enable_index(current) + irq);
+
+			_affinity[irq] = (unsigned char)hart;
+			write<Enable>(1, enable_index(hart) + irq);
 		}
 
 		void el(unsigned, unsigned) { }
@@ -0,0 +1,84 @@
+/*
+ * \brief  Data-cache maintenance for DMA buffers via RISC-V Zicbom
+ * \author agent
+ * \date   2026-10-16
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#ifndef _SRC__DRIVER__NIC__OPENCORES__CACHE_H_
+#define _SRC__DRIVER__NIC__OPENCORES__CACHE_H_
+
+#include <base/stdint.h>
+
+namespace Zicbom {
+
+	using Genode::addr_t;
+	using Genode::size_t;
+
+	/*
+	 * Cache-block operations trap at user level unless the kernel permits
+	 * them via senvcfg.CBCFE/CBIE, which base-hw does not do on RISC-V
+	 */
+	static constexpr bool USER_LEVEL = false;
+
+	/*
+	 * DMA buffers are aligned to 64 bytes, a larger cache block would be
+	 * shared by adjacent buffers
+	 */
+	static constexpr size_t MAX_BLOCK_SIZE = 64;
+
+	static inline bool valid_block_size(size_t const block_size)
+	{
+		return block_size && (block_size & (block_size - 1)) == 0
+		    && block_size <= MAX_BLOCK_SIZE;
+	}
+
+	/*
+	 * The cache-block operations are encoded via '.insn' so that no
+	 * assembler support for Zicbom is required:
+	 *
+	 * cbo.inval = 0x00, cbo.clean = 0x01, cbo.flush = 0x02 in the immediate
+	 * field of a MISC-MEM (0x0f) instruction with funct3 = 2
+	 */
+	static inline void cbo_inval(addr_t addr) {
+		asm volatile (".insn i 0x0f, 2, x0, %0, 0" : : "r"(addr) : "memory"); }
+
+	static inline void cbo_clean(addr_t addr) {
+		asm volatile (".insn i 0x0f, 2, x0, %0, 1" : : "r"(addr) : "memory"); }
+
+	template <typename FN>
+	static inline void for_each_block(void const *addr, size_t size,
+	                                  size_t block_size, FN const &fn)
+	{
+		addr_t       start = (addr_t)addr & ~(block_size - 1);
+		addr_t const end   = (addr_t)addr + size;
+
+		for (; start < end; start += block_size)
+			fn(start);
+
+		asm volatile ("fence rw, rw" : : : "memory");
+	}
+
+	/**
+	 * Write back dirty cache blocks before the device reads the memory
+	 */
+	static inline void clean(void const *addr, size_t size, size_t block_size) {
+		for_each_block(addr, size, block_size, [] (addr_t a) { cbo_clean(a); }); }
+
+	/**
+	 * Discard cached copies before the CPU reads memory written by the device
+	 *
+	 * The memory range must not share cache blocks with data written by the
+	 * CPU, which is ensured by aligning DMA buffers to the cache-block size.
+	 */
+	static inline void invalidate(void const *addr, size_t size, size_t block_size) {
+		for_each_block(addr, size, block_size, [] (addr_t a) { cbo_inval(a); }); }
+}
+
+#endif /* _SRC__DRIVER__NIC__OPENCORES__CACHE_H_ */
@@ -0,0 +1,243 @@
+/*
+ * \brief  Frame-capture ring shared between NIC driver and capture component
+ * \author agent
+ * \date   2026-10-16
+ *
+ * The driver appends a record per frame to a ring in a dataspace, which the
+ * capture component maps read-only. The ring never applies back pressure to
+ * the driver: records are overwritten once the ring wrapped around, and the
+ * reader detects that it was overtaken by the absolute position stored in
+ * each record. Hence, there is exactly one writer and no shared state written
+ * by the reader. The writer does not rely on the header either, which merely
+ * publishes its parameters to the reader.
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#ifndef _SRC__DRIVER__NIC__OPENCORES__CAPTURE_H_
+#define _SRC__DRIVER__NIC__OPENCORES__CAPTURE_H_
+
+#include <base/stdint.h>
+#include <cpu/memory_barrier.h>
+#include <util/misc_math.h>
+#include <util/string.h>
+
+namespace Capture {
+
+	using namespace Genode;
+
+	struct Header;
+	struct Record;
+	class  Writer;
+	class  Reader;
+
+	enum class Direction : uint8_t { RX = 0, TX = 1 };
+}
+
+
+struct Capture::Header
+{
+	enum : uint32_t { MAGIC = 0x4e434150 /* "NCAP" */ };
+
+	uint32_t magic;
+	uint32_t snaplen;
+	uint64_t size;             /* bytes of the record area */
+	uint64_t volatile head;    /* absolute write position, published last */
+};
+
+
+struct Capture::Record
+{
+	enum : uint8_t { TX = 1, WRAP = 2 };
+
+	uint64_t pos;          /* absolute position, distinguishes laps */
+	uint64_t timestamp;    /* 'Trace::timestamp' of the writer */
+	uint32_t length;       /* length of the frame */
+	uint16_t captured;     /* bytes of the frame following the record */
+	uint8_t  port;
+	uint8_t  flags;
+
+	static size_t size(size_t const captured) {
+		return align_addr(sizeof(Record) + captured, 3); }
+
+	Direction direction() const {
+		return (flags & TX) ? Direction::TX : Direction::RX; }
+};
+
+
+class Capture::Writer
+{
+	private:
+
+		Header &_header;
+		char  * const _records;
+		uint64_t const _size;
+		size_t   const _snaplen;
+		uint64_t _head { 0 };
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param base     dataspace holding the ring
+		 * \param size     size of the dataspace
+		 * \param snaplen  maximum number of bytes captured per frame, at
+		 *                 most a quarter of the ring
+		 */
+		Writer(void *base, size_t const size, size_t const snaplen)
+		:
+			_header(*(Header *)base), _records((char *)base + sizeof(Header)),
+			_size((size - sizeof(Header)) & ~(size_t)7),
+			_snaplen(min(snaplen, (size_t)(_size / 4 - sizeof(Record))))
+		{
+			_header.snaplen = (uint32_t)_snaplen;
+			_header.size    = _size;
+			_header.head    = 0;
+
+			memory_barrier();
+			_header.magic = Header::MAGIC;
+		}
+
+		void write(unsigned const port, Direction const direction,
+		           uint64_t const timestamp, void const *frame, size_t const length)
+		{
+			size_t const captured = min(length, _snaplen);
+			size_t const size     = Record::size(captured);
+
+			uint64_t offset = _head % _size;
+
+			/* records do not wrap, mark the rest of the ring as unused */
+			if (offset + size > _size) {
+				if (_size - offset >= sizeof(Record))
+					*(Record *)(_records + offset) = {
+						.pos = _head, .timestamp = 0, .length = 0, .captured = 0,
+						.port = 0, .flags = Record::WRAP };
+
+				_head += _size - offset;
+				offset = 0;
+			}
+
+			Record &record = *(Record *)(_records + offset);
+			record = {
+				.pos       = _head,
+				.timestamp = timestamp,
+				.length    = (uint32_t)length,
+				.captured  = (uint16_t)captured,
+				.port      = (uint8_t)port,
+				.flags     = (uint8_t)(direction == Direction::TX ? Record::TX : 0) };
+
+			memcpy(&record + 1, frame, captured);
+
+			_head += size;
+
+			/* publish the record after its content */
+			memory_barrier();
+			_header.head = _head;
+		}
+};
+
+
+class Capture::Reader
+{
+	private:
+
+		Header const &_header;
+		char   const * const _records;
+		uint64_t const _size;
+		uint64_t const _max_record;
+
+		uint64_t _tail;
+
+		/*
+		 * The writer may be busy with the record following 'head', which
+		 * may include the unused end of the ring
+		 */
+		bool _overwritten(uint64_t const pos) const {
+			return _header.head + 2 * _max_record - pos > _size; }
+
+	public:
+
+		uint64_t overruns { 0 };
+
+		/**
+		 * Constructor, reading starts with the next record written
+		 */
+		Reader(void const *base)
+		:
+			_header(*(Header const *)base),
+			_records((char const *)base + sizeof(Header)),
+			_size(_header.size),
+			_max_record(Record::size(_header.snaplen)),
+			_tail(_header.head)
+		{ }
+
+		static bool valid(void const *base) {
+			return ((Header const *)base)->magic == Header::MAGIC; }
+
+		size_t snaplen() const { return _header.snaplen; }
+
+		/**
+		 * Call 'fn' for each new record with a copy of the captured bytes
+		 *
+		 * \param buffer  buffer of at least 'snaplen' bytes
+		 *
+		 * \return  number of records passed to 'fn'
+		 */
+		template <typename FN>
+		unsigned for_each_record(char *buffer, FN const &fn)
+		{
+			unsigned count = 0;
+
+			uint64_t const head = _header.head;
+			memory_barrier();
+
+			while (_tail < head) {
+
+				if (_overwritten(_tail)) {
+					overruns++;
+					_tail = _header.head;
+					break;
+				}
+
+				uint64_t const offset = _tail % _size;
+
+				if (_size - offset < sizeof(Record)) {
+					_tail += _size - offset;
+					continue;
+				}
+
+				Record const record = *(Record const *)(_records + offset);
+
+				if (record.flags & Record::WRAP) {
+					_tail += _size - offset;
+					continue;
+				}
+
+				memcpy(buffer, _records + offset + sizeof(Record),
+				       min((size_t)record.captured, snaplen()));
+
+				/* discard the copy if the writer caught up meanwhile */
+				memory_barrier();
+				if (record.pos != _tail || _overwritten(_tail)) {
+					overruns++;
+					_tail = _header.head;
+					break;
+				}
+
+				fn(record, (void const *)buffer);
+				count++;
+
+				_tail += Record::size(record.captured);
+			}
+
+			return count;
+		}
+};
+
+#endif /* _SRC__DRIVER__NIC__OPENCORES__CAPTURE_H_ */
@@ -0,0 +1,107 @@
+/*
+ * \brief  Copy routines for uncached DMA buffers
+ * \author agent
+ * \date   2026-10-16
+ *
+ * Each access to uncached memory is a separate bus transaction, and byte or
+ * half-word stores may be performed as read-modify-write of the enclosing
+ * word. The routines therefore access the DMA buffer solely by aligned
+ * 64-bit words. Unaligned accesses to the cached side are avoided as well,
+ * because they trap on harts without hardware support for misaligned
+ * accesses.
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#ifndef _SRC__DRIVER__NIC__OPENCORES__DMA_COPY_H_
+#define _SRC__DRIVER__NIC__OPENCORES__DMA_COPY_H_
+
+#include <base/stdint.h>
+
+namespace Dma_copy {
+
+	using Genode::addr_t;
+	using Genode::size_t;
+	using Genode::uint8_t;
+	using Genode::uint64_t;
+
+	enum { WORD = sizeof(uint64_t) };
+
+	static inline bool aligned(void const *ptr) {
+		return ((addr_t)ptr & (WORD - 1)) == 0; }
+
+	/*
+	 * Little-endian assembly of a word from cached memory of any alignment
+	 */
+	static inline uint64_t load(uint8_t const *src, size_t const count = WORD)
+	{
+		uint64_t value = 0;
+		for (size_t i = 0; i < count; i++)
+			value |= (uint64_t)src[i] << (8 * i);
+
+		return value;
+	}
+
+	static inline void store(uint8_t *dst, uint64_t value, size_t const count = WORD)
+	{
+		for (size_t i = 0; i < count; i++, value >>= 8)
+			dst[i] = (uint8_t)value;
+	}
+
+	/**
+	 * Copy 'size' bytes into the uncached buffer 'dst'
+	 *
+	 * 'dst' must be word aligned. The last word is written completely, so
+	 * the buffer must be writable up to the next word boundary after 'size'.
+	 */
+	static inline void to_device(void *dst, void const *src, size_t const size)
+	{
+		uint64_t volatile *d = (uint64_t volatile *)dst;
+		uint8_t  const    *s = (uint8_t const *)src;
+
+		size_t const words = size / WORD;
+		size_t const tail  = size % WORD;
+
+		if (aligned(s))
+			for (size_t i = 0; i < words; i++)
+				d[i] = ((uint64_t const *)s)[i];
+		else
+			for (size_t i = 0; i < words; i++)
+				d[i] = load(s + i * WORD);
+
+		/* pad the tail to a whole word */
+		if (tail)
+			d[words] = load(s + words * WORD, tail);
+	}
+
+	/**
+	 * Copy 'size' bytes out of the uncached buffer 'src'
+	 *
+	 * 'src' must be word aligned, the last word is read completely.
+	 */
+	static inline void from_device(void *dst, void const *src, size_t const size)
+	{
+		uint8_t               *d = (uint8_t *)dst;
+		uint64_t const volatile *s = (uint64_t const volatile *)src;
+
+		size_t const words = size / WORD;
+		size_t const tail  = size % WORD;
+
+		if (aligned(d))
+			for (size_t i = 0; i < words; i++)
+				((uint64_t *)d)[i] = s[i];
+		else
+			for (size_t i = 0; i < words; i++)
+				store(d + i * WORD, s[i]);
+
+		if (tail)
+			store(d + words * WORD, s[words], tail);
+	}
+}
+
+#endif /* _SRC__DRIVER__NIC__OPENCORES__DMA_COPY_H_ */
@@ -11,531 +11,1267 @@
  * under the terms of the GNU Affero General Public License version 3.
  */
 
-#include <base/attached_rom_dataspace.h>
+
 #include <base/attached_ram_dataspace.h>
+#include <base/attached_rom_dataspace.h>
 #include <base/component.h>
 #include <base/heap.h>
 #include <base/sleep.h>
 #include <dataspace/client.h>
 #include <irq_session/connection.h>
-#include <net/mac_address.h>
+#include <os/reporter.h>
 #include <platform_session/device.h>
 #include <platform_session/dma_buffer.h>
+#include <rom_session/rom_session.h>
+#include <root/component.h>
 #include <timer_session/connection.h>
+#include <trace/timestamp.h>
 #include <util/reconstructible.h>
 
 #include <drivers/nic/uplink_client_base.h>
 
+/* local includes */
+#include <capture.h>
+#include <opencores.h>
+#include <phy.h>
+
 using namespace Genode;
 
 namespace Genode {
-	class Opencores;
-	template<typename T> class Uplink_client;
+	class Capture_service;
+	class Dma_mem;
+	class Nic_port;
+	class Uplink_client;
 }
 
 
-class Genode::Opencores : Mmio<0x400 + 64 * 8 + 64 * 8>
+/*
+ * On MiG-V normal SDRAM allocations lead to packet underruns of TX packets.
+ * Therefore, we revert to SRAM (not using an Attached_ram_dataspace) which
+ * can be configured through the 'dma_mem' config node. Each port uses the
+ * I/O memory of its own device, which must be large enough to hold the
+ * buffers of all descriptors (256KB for the default geometry).
+ */
+class Genode::Dma_mem
 {
+	public:
+
+		/*
+		 * Caching of DMA buffers allocated from RAM, selected by 'dma_cache'
+		 *
+		 * "coherent"  cached, the device snoops the caches as on the Qemu
+		 *             virt machine (default)
+		 * "cached"    cached with Zicbom maintenance around each hand-off,
+		 *             refused unless the kernel permits cache-block
+		 *             operations at user level (see 'Zicbom::USER_LEVEL')
+		 * "uncached"  for devices that neither snoop nor allow for cache
+		 *             maintenance
+		 *
+		 * The I/O memory used for DMA on MiG-V is always accessed uncached,
+		 * which makes uncached buffers the default on that board.
+		 */
+		struct Cache
+		{
+			bool   cached;
+			size_t block_size; /* of cache maintenance, 0 if coherent */
+
+			static Cache from_config(Node const &config)
+			{
+				using Mode = String<16>;
+
+				Cache const uncached { .cached = false, .block_size = 0 };
+				Cache const coherent { .cached = true,  .block_size = 0 };
+
+				Mode const mode = config.attribute_value("dma_cache", Mode("coherent"));
+
+				if (mode == "uncached") return uncached;
+				if (mode == "coherent") return coherent;
+
+				if (mode != "cached") {
+					warning("unknown DMA cache mode '", mode, "', using coherent");
+					return coherent;
+				}
+
+				if (!Zicbom::USER_LEVEL) {
+					error("cache-block operations are not permitted by the kernel, "
+					      "using uncached DMA buffers");
+					return uncached;
+				}
+
+				size_t const block_size = config.attribute_value("cache_block_size", 64ul);
+
+				if (!Zicbom::valid_block_size(block_size)) {
+					warning("invalid cache block size ", block_size,
+					        ", using uncached DMA buffers");
+					return uncached;
+				}
+
+				return { .cached = true, .block_size = block_size };
+			}
+		};
+
 	private:
 
-		/* number of descriptors */
-		enum { RX = 64, TX = 64 };
+		using Device = Platform::Device;
 
-		Env           &  _env;
-		Mmio::Delayer &  _delayer;
-		Net::Mac_address _mac;
+		Constructible<Device::Mmio<0> >     _mmio_mem { };
+		Constructible<Platform::Dma_buffer> _dma_mem { };
+		addr_t                              _base { 0 };
+		addr_t                              _dma_addr { 0 };
+		size_t                              _size;
+		bool                                _cached     { false };
+		size_t                              _block_size { 0 };
 
-		/*
-		 * PHY=1 for Qemu, PHY=0 for MiG-V Eth0, and PHY=1 for MiG-V Eth1
-		 */
-		const unsigned _phy_port;
+	public:
 
-		/*
-		 * On MiG-V normal SDRAM allocations lead to packet underruns of TX packets.
-		 * Therefore, we revert to SRAM (not using an Attached_ram_dataspace) which
-		 * can be configured through the 'dma_mem' config node. 256KB of DMA memory
-		 * are required.
+		/**
+		 * Constructor
+		 *
+		 * \param name  name of 'device', or invalid for the first device
+		 *              of type "opencores,ethoc"
 		 */
-		class Dma_mem
+		Dma_mem(Platform::Connection &platform,
+		        Platform::Device &device, Device::Name const &name,
+		        size_t const size, Cache const &cache)
+		:
+			_size(size)
 		{
-			private:
+			using String = String<64>;
 
-				using Device = Platform::Device;
+			bool found = false;
 
-				Constructible<Device::Mmio<0> >     _mmio_mem { };
-				Constructible<Platform::Dma_buffer> _dma_mem { };
-				addr_t                              _base { 0 };
-				addr_t                              _dma_addr { 0 };
+			/* search for I/O mem resource for DMA = resource (1) */
+			platform.update();
+			platform.with_node([&] (Node const &node) {
+				node.for_each_sub_node("device", [&] (Node const &node) {
 
-			public:
+					String type = node.attribute_value("type", String());
+					if (type != "opencores,ethoc" || found)
+						return;
 
-				Dma_mem(Platform::Connection &platform,
-				        Platform::Device &device)
-				{
-					using String = String<64>;
+					if (name.valid() && node.attribute_value("name", Device::Name()) != name)
+						return;
 
-					/* search for I/O mem resource for DMA = resource (1) */
-					platform.update();
-					platform.with_node([&] (Node const &node) {
-						node.for_each_sub_node("device", [&] (Node const &node) {
+					found = true;
 
-							String type = node.attribute_value("type", String());
-							if (type == "opencores,ethoc") {
-								node.for_each_sub_node("io_mem", [&] (Node const &io_mem_node) {
+					unsigned index = 0;
+					node.for_each_sub_node("io_mem", [&] (Node const &io_mem_node) {
 
-									addr_t size = io_mem_node.attribute_value("size", 0ul);
-									if (size != 0x40000) return;
+						if (index++ != 1) return;
 
-									_dma_addr = io_mem_node.attribute_value("phys_addr", 0ul);
-									if (_dma_addr == 0) return;
+						addr_t io_mem_size = io_mem_node.attribute_value("size", 0ul);
+						if (io_mem_size < size) {
+							warning("I/O memory for DMA too small (", io_mem_size,
+							        " < ", size, " bytes)");
+							return;
+						}
 
-									_mmio_mem.construct(device, Device::Mmio<0>::Index{ 1 });
-									_base = (addr_t)_mmio_mem->local_addr<void>();
-									log("Using I/O Memory for DMA");
-								});
-							}
-						});
+						_dma_addr = io_mem_node.attribute_value("phys_addr", 0ul);
+						if (_dma_addr == 0) return;
+
+						_mmio_mem.construct(device, Device::Mmio<0>::Index{ 1 });
+						_base = (addr_t)_mmio_mem->local_addr<void>();
+						log("Using I/O Memory for DMA");
 					});
+				});
+			});
+
+			if (_base && _dma_addr)
+				return;
+
+			/* use regular DMA memory */
+			_cached     = cache.cached;
+			_block_size = cache.block_size;
+			_dma_mem.construct(platform, size, _cached ? CACHED : UNCACHED);
+			_base = (addr_t)_dma_mem->local_addr<void>();
+			_dma_addr = _dma_mem->dma_addr();
+			log("Using ", !_cached ? "uncached" : _block_size ? "cached" : "coherent",
+			    " RAM for DMA");
+		}
 
-					if (_base && _dma_addr)
-						return;
+		/**
+		 * Return window of 'size' bytes at 'offset' for one port
+		 *
+		 * The NIC only supports 32 bit descriptor addresses.
+		 */
+		Opencores::Dma_window window(size_t const offset, size_t const size) const
+		{
+			if (offset + size > _size) {
+				error("DMA window exceeds DMA memory");
+				throw -1;
+			}
 
-					/* use regular DMA memory */
-					_dma_mem.construct(platform, 128*2048, UNCACHED);
-					_base = (addr_t)_dma_mem->local_addr<void>();
-					_dma_addr = _dma_mem->dma_addr();
-					log("Using RAM for DMA");
-				}
+			return { .local_addr       = _base + offset,
+			         .dma_addr         = (uint32_t)(_dma_addr + offset),
+			         .size             = size,
+			         .cached           = _cached,
+			         .cache_block_size = _block_size };
+		}
+};
 
-				addr_t local_addr() const
-				{
-					return _base;
-				}
 
-				/*
-				 * the NIC only supports 32 bit descriptor addresses
-				 */
-				uint32_t dma_addr()
-				{
-					return (uint32_t)_dma_addr;
-				}
-		};
+/*
+ * Frame capture for debugging, enabled by a '<capture>' config node
+ *
+ * Frames are recorded into a ring in a RAM dataspace, which is handed out
+ * as ROM module to a capture component such as 'nic_capture'. Read-only
+ * access is a convention of ROM clients, not enforced: the capability
+ * refers to a plain RAM dataspace that a client may attach writable.
+ * Hence, the writer never reads back from the ring. The ring is
+ * overwritten continuously, so a slow or absent reader does not affect the
+ * driver. Without capture, the hot paths test a null pointer.
+ */
+class Genode::Capture_service
+{
+	private:
 
-		Dma_mem _dma_mem;
+		struct Session_component : Rpc_object<Rom_session>
+		{
+			Dataspace_capability const _ds;
 
-		unsigned _current_tx { 0 };
-		unsigned _current_rx { 0 };
+			Session_component(Dataspace_capability ds) : _ds(ds) { }
 
-		struct Moder : Register<0x0, 32>
-		{
-			struct RxEn    : Bitfield<0, 1>  { }; /* rx enable */
-			struct TxEn    : Bitfield<1, 1>  { }; /* tx enable */
-			struct NoPre   : Bitfield<2, 1>  { }; /* no preamble */
-			struct Bro     : Bitfield<3, 1>  { }; /* receive broadcast */
-			struct Pro     : Bitfield<5, 1>  { }; /* promiscuous  mode */
-			struct Ifg     : Bitfield<6, 1>  { }; /* Inter frame gap */
-			struct Exdfren : Bitfield<9, 1>  { }; /* Excess defer enabled */
-			struct Fulld   : Bitfield<10, 1> { }; /* Full/Half duplex */
-			struct Crcen   : Bitfield<13, 1> { }; /* Enable TX CRC */
+			Rom_dataspace_capability dataspace() override {
+				return static_cap_cast<Rom_dataspace>(_ds); }
+
+			/* the ROM module never changes */
+			void sigh(Signal_context_capability) override { }
 		};
 
-		struct Int_source : Register<0x4, 32>
+		struct Root : Root_component<Session_component>
 		{
-			struct Txb : Bitfield<0, 1> { };
-			struct Rxb : Bitfield<2, 1> { };
+			Dataspace_capability const _ds;
+
+			Create_result _create_session(const char *) override {
+				return *new (md_alloc()) Session_component(_ds); }
+
+			Root(Entrypoint &ep, Allocator &md_alloc, Dataspace_capability ds)
+			:
+				Root_component<Session_component>(ep, md_alloc), _ds(ds)
+			{ }
 		};
 
-		struct Int_mask : Register<0x8, 32>
+		Attached_ram_dataspace _ds;
+
+	public:
+
+		Capture::Writer writer;
+
+	private:
+
+		Root _root;
+
+	public:
+
+		Capture_service(Env &env, Allocator &alloc, size_t const size,
+		                size_t const snaplen)
+		:
+			_ds(env.ram(), env.rm(), size),
+			writer(_ds.local_addr<void>(), size, snaplen),
+			_root(env.ep(), alloc, _ds.cap())
 		{
-			struct Txb : Bitfield<0, 1> { };
-			struct Rxb : Bitfield<2, 1> { }; /*  receive frame */
-		};
+			env.parent().announce(env.ep().manage(_root));
+			log("capturing up to ", snaplen, " bytes per frame into ",
+			    size / 1024, " KiB");
+		}
+};
 
-		/* packet gap registers */
-		struct Ipgt  : Register<0xc,  32> { };
 
-		struct Tx_bd : Register<0x20, 32>
+/*
+ * Ethernet port, a MAC with its PHY and interrupt
+ */
+class Genode::Nic_port
+{
+	public:
+
+		using Name = String<16>;
+
+		struct Config
 		{
-			/*
-			 * Number of TX buffer descriptors starting at 0x400 (total descriptors
-			 * 128 a 8 byte), (0x7ff - Num * 8) / 8 = number of RX descriptors
-			 */
-			struct Num : Bitfield<0, 8> { };
+			Name             name;
+			Net::Mac_address mac;
+			unsigned         phy_port;
+			unsigned         index;    /* as recorded by frame capture */
 		};
 
-		struct Miimoder : Register<0x28, 32>
+		struct Irq_handler : Interface
 		{
-			struct Miinopre : Bitfield<8, 1> { }; /* nor preamble */
-			struct Clkdiv : Bitfield<0, 8> { };
+			virtual void handle_irq(Nic_port &) = 0;
 		};
 
-		struct Miicommand : Register<0x2c, 32>
+	private:
+
+		Platform::Device::Mmio<0> _mmio;
+		Platform::Device::Irq     _irq;
+
+		Irq_handler *_handler { nullptr };
+
+		Signal_handler<Nic_port> _irq_handler;
+
+		void _handle_irq()
 		{
-			struct Rstat    : Bitfield<1, 1> { };
-			struct Wtrldata : Bitfield<2, 1> { };
+			if (_handler)
+				_handler->handle_irq(*this);
+
+			_irq.ack();
+		}
+
+	public:
+
+		Name      const name;
+		unsigned  const index;
+		Opencores       nic;
+		Phy             phy;
+		Phy::Link       link { .up = false, .speed = 0, .full_duplex = false };
+
+		/* TX completions and pending frames seen by the last watchdog check */
+		uint64_t tx_progress { 0 };
+		unsigned tx_used     { 0 };
+
+		/* submission time per TX descriptor, zero if not measured */
+		Trace::Timestamp tx_stamp[Opencores::Geometry::MAX_DESCRIPTORS] { };
+
+		Nic_port(Entrypoint                  &ep,
+		         Platform::Device            &device,
+		         Config                const &config,
+		         Opencores::Dma_window const &dma,
+		         Opencores::Geometry   const &geometry,
+		         Opencores::Filter     const &filter,
+		         bool                  const  autoneg,
+		         Mmio<0>::Delayer            &delayer)
+		:
+			_mmio(device), _irq(device),
+			_irq_handler(ep, *this, &Nic_port::_handle_irq),
+			name(config.name), index(config.index),
+			nic(_mmio.range(), dma, config.mac, config.phy_port, geometry, filter, delayer),
+			phy(nic, autoneg)
+		{
+			_irq.sigh(_irq_handler);
+			_irq.ack();
+		}
+
+		void irq_handler(Irq_handler &handler) { _handler = &handler; }
+};
+
+
+class Genode::Uplink_client : public Uplink_client_base, public Nic_port::Irq_handler
+{
+	public:
+
+		enum { MAX_PORTS = 2 };
+
+		/*
+		 * Ports served by the Uplink session, more than one port are bonded
+		 */
+		struct Ports
+		{
+			Nic_port *port[MAX_PORTS];
+			unsigned  count;
 		};
 
-		struct Miiaddress : Register<0x30, 32>
+		/*
+		 * Interrupt moderation
+		 *
+		 * In 'ADAPTIVE' mode, the driver switches from interrupts to
+		 * timer-driven polling once a single interrupt yields at least
+		 * 'threshold' frames. While polling, each poll harvests at most
+		 * 'budget' frames with interrupts masked at the device. After 'idle'
+		 * consecutive polls without any received frame, interrupts are
+		 * enabled again. In 'BUSY_POLL' mode, interrupts stay masked and the
+		 * entrypoint spins on the descriptor rings.
+		 */
+		struct Polling
 		{
-			struct Fiad : Bitfield<0, 5> { }; /* Phy address */
-			struct Rgad : Bitfield<8, 5> { }; /* register address */
+			enum class Mode { INTERRUPT, ADAPTIVE, BUSY_POLL };
+
+			Mode     mode;
+			unsigned interval_us;
+			unsigned budget;
+			unsigned threshold;
+			unsigned idle;
+
+			static Polling from_config(Node const &config)
+			{
+				using Name = String<16>;
+
+				Name const name = config.attribute_value("irq_mode", Name("interrupt"));
+
+				Mode const mode = (name == "adaptive")  ? Mode::ADAPTIVE
+				                : (name == "busy_poll") ? Mode::BUSY_POLL
+				                :                         Mode::INTERRUPT;
+
+				return {
+					.mode        = mode,
+					.interval_us = max(config.attribute_value("poll_interval_us", 250u), 1u),
+					.budget      = max(config.attribute_value("poll_budget",       32u), 1u),
+					.threshold   = max(config.attribute_value("poll_threshold",     8u), 1u),
+					.idle        = max(config.attribute_value("poll_idle",          4u), 1u),
+				};
+			}
 		};
 
-		struct Miitx_data : Register<0x34, 32>
+		/*
+		 * Settings that can be changed at runtime, see 'configure'
+		 */
+		struct Settings
 		{
-			struct Ctrldata : Bitfield<0, 16> { }; /* control data to PHY */
+			Polling polling;
+
+			/*
+			 * With batched RX, all frames of a pass over the RX ring are
+			 * submitted to the Uplink session without waking up the client,
+			 * which is woken up once at the end of the pass
+			 */
+			bool rx_batch;
+
+			/*
+			 * With a non-zero RX budget, an RX burst is forwarded in chunks
+			 * of 'budget' frames, and the client's pending transmits are
+			 * serviced in between. Forwarding workloads thereby overlap RX
+			 * and TX instead of transmitting only after the complete burst
+			 * was received.
+			 */
+			unsigned rx_budget;
+
+			/* a zero timeout disables the TX watchdog */
+			Microseconds tx_timeout;
+
+			/* measure latencies of the driver path, see 'Latency' */
+			bool latency;
+
+			static Settings from_config(Node const &config)
+			{
+				uint64_t const tx_timeout_ms =
+					config.attribute_value("tx_timeout_ms", (uint64_t)100);
+
+				return {
+					.polling    = Polling::from_config(config),
+					.rx_batch   = config.attribute_value("rx_batch", true),
+					.rx_budget  = config.attribute_value("rx_budget", 0u),
+					.tx_timeout = Microseconds(tx_timeout_ms * 1000),
+					.latency    = config.attribute_value("latency", false),
+				};
+			}
 		};
 
-		struct Miirx_data : Register<0x38, 32>
+		/*
+		 * Driver statistics
+		 *
+		 * The packets-per-interrupt histogram uses power-of-two buckets
+		 * (0, 1, 2-3, 4-7, ...), the last bucket collects everything above.
+		 */
+		struct Statistics
 		{
-			struct Prsd : Bitfield<0, 16> { }; /* received data from PHY */
+			enum { BUCKETS = 8 };
+
+			uint64_t irqs        { 0 };
+			uint64_t irq_packets { 0 }; /* RX frames and TX completions */
+			uint64_t polls       { 0 };
+			uint64_t retries     { 0 }; /* RETRY results of '_drv_transmit_pkt' */
+			uint64_t rx_wakeups  { 0 }; /* client wakeups of batched RX */
+			uint64_t rx_yields   { 0 }; /* RX bursts interrupted for TX */
+
+			uint64_t histogram[BUCKETS] { };
+
+			void irq(unsigned const packets)
+			{
+				irqs++;
+				irq_packets += packets;
+
+				unsigned bucket = 0;
+				for (unsigned p = packets; p && bucket < BUCKETS - 1; p >>= 1)
+					bucket++;
+
+				histogram[bucket]++;
+			}
+
+			void generate(Generator &g) const
+			{
+				g.node("irq", [&] {
+					g.attribute("count",   irqs);
+					g.attribute("packets", irq_packets);
+					g.attribute("packets_per_irq_x100",
+					            irqs ? irq_packets * 100 / irqs : 0);
+
+					for (unsigned i = 0; i < BUCKETS; i++)
+						g.node("histogram", [&] {
+							g.attribute("min", i ? 1u << (i - 1) : 0u);
+							if (i < BUCKETS - 1)
+								g.attribute("max", i ? (1u << i) - 1 : 0u);
+							g.attribute("count", histogram[i]);
+						});
+				});
+				g.node("poll",     [&] { g.attribute("count", polls); });
+				g.node("tx_retry", [&] { g.attribute("count", retries); });
+				g.node("rx_wakeup", [&] { g.attribute("count", rx_wakeups); });
+				g.node("rx_yield",  [&] { g.attribute("count", rx_yields); });
+			}
 		};
 
-		struct Miistatus : Register<0x3c, 32>
+		/*
+		 * Latency histograms of the driver path
+		 *
+		 * Time stamps are taken via 'Trace::timestamp', which reads the
+		 * 'time' CSR on RISC-V. The buckets are powers of two of timestamp
+		 * ticks, which are converted to nanoseconds when reporting. The
+		 * resolution is the period of the 'time' CSR, which is 30.5 us on
+		 * MiG-V (32 kHz). There, the short intervals of 'irq_to_rx' and
+		 * 'rx_handoff' fall almost entirely into the 0-tick bucket.
+		 *
+		 * The driver does not observe when the NIC completes a TX descriptor
+		 * but when it reclaims the descriptor. Descriptors that completed
+		 * without interrupt because of the TX IRQ interval are reclaimed with
+		 * the next interrupt, harvest, or watchdog check. Hence, 'tx_reclaim'
+		 * includes this lag and approximates the completion time only with
+		 * 'tx_irq_interval="1"'.
+		 */
+		struct Latency
 		{
-			struct Busy : Bitfield<1, 1> { };
+			struct Histogram
+			{
+				enum { BUCKETS = 32 };
+
+				uint64_t count { 0 };
+				uint64_t sum   { 0 };
+				uint64_t max   { 0 };
+
+				uint64_t buckets[BUCKETS] { };
+
+				void record(uint64_t const ticks)
+				{
+					count++;
+					sum += ticks;
+					max  = Genode::max(max, ticks);
+
+					unsigned bucket = 0;
+					for (uint64_t t = ticks; t && bucket < BUCKETS - 1; t >>= 1)
+						bucket++;
+
+					buckets[bucket]++;
+				}
+
+				void generate(Generator &g, char const *name, uint64_t const ticks_per_ms) const
+				{
+					auto ns = [&] (uint64_t const ticks) {
+						return ticks_per_ms ? ticks * 1000 * 1000 / ticks_per_ms : 0; };
+
+					g.node(name, [&] {
+						g.attribute("count",   count);
+						g.attribute("mean_ns", ns(count ? sum / count : 0));
+						g.attribute("max_ns",  ns(max));
+
+						for (unsigned i = 0; i < BUCKETS; i++) {
+							if (!buckets[i]) continue;
+
+							g.node("bucket", [&] {
+								g.attribute("max_ns", ns(i ? (1ull << i) - 1 : 0));
+								g.attribute("count", buckets[i]);
+							});
+						}
+					});
+				}
+			};
+
+			Histogram irq_to_rx     { }; /* IRQ entry to first harvested RX descriptor  */
+			Histogram rx_handoff    { }; /* harvest to submission to the Uplink client */
+			Histogram irq_service   { }; /* IRQ entry to exit                           */
+			Histogram tx_reclaim    { }; /* TX submission to reclaim                    */
+			Histogram poll_signal   { }; /* busy-poll signal to its handler             */
+
+			void generate(Generator &g, uint64_t const ticks_per_ms) const
+			{
+				g.node("latency", [&] {
+					g.attribute("ticks_per_ms", ticks_per_ms);
+					irq_to_rx    .generate(g, "irq_to_rx",     ticks_per_ms);
+					rx_handoff   .generate(g, "rx_handoff",    ticks_per_ms);
+					irq_service  .generate(g, "irq_service",   ticks_per_ms);
+					tx_reclaim   .generate(g, "tx_reclaim",    ticks_per_ms);
+					poll_signal  .generate(g, "poll_signal",   ticks_per_ms);
+				});
+			}
 		};
 
-		/* reverse order 0 = byte 5, 5 = byte 0 */
-		struct Mac_addr : Register_array<0x40, 32, 6, 8> { };
+	private:
+
+		Env &_env;
+
+		Ports const _ports;
 
-		void _configure_mac_address()
+		Settings _settings;
+
+		Capture::Writer * const _capture;
+
+		void _capture_frame(Nic_port const &port, Capture::Direction const direction,
+		                    void const *frame, size_t const length)
 		{
-			for (unsigned i = 0; i < 6; i++) {
-				write<Mac_addr>(_mac.addr[5 - i], i);
+			if (_capture)
+				_capture->write(port.index, direction, Trace::timestamp(), frame, length);
+		}
+
+		/* set when a packet was refused because of a full TX ring */
+		bool _tx_stalled { false };
+
+		/* state of adaptive mode */
+		bool     _polling_active { false };
+		unsigned _idle_polls     { 0 };
+
+		Statistics _stats { };
+
+		Latency _latency { };
+
+		Trace::Timestamp _stamp() const {
+			return _settings.latency ? Trace::timestamp() : 0; }
+
+		/* entry of the IRQ handler until the first RX descriptor was harvested */
+		Trace::Timestamp _irq_entry { 0 };
+
+		/**
+		 * Record the harvest of an RX descriptor
+		 *
+		 * \return  time stamp of the harvest
+		 */
+		Trace::Timestamp _rx_harvested()
+		{
+			Trace::Timestamp const now = _stamp();
+
+			if (_irq_entry) {
+				_latency.irq_to_rx.record(now - _irq_entry);
+				_irq_entry = 0;
 			}
+
+			return now;
 		}
 
-		void _enable()
+		template <typename FN>
+		void _for_each_port(FN const &fn) const
 		{
-			write<Moder::TxEn>(1);
-			write<Moder::RxEn>(1);
+			for (unsigned i = 0; i < _ports.count; i++)
+				fn(*_ports.port[i]);
 		}
 
+		/*
+		 * The links are polled via the PHYs, more frequently while a link is
+		 * down to bring up the Uplink session or a bonded port quickly
+		 *
+		 * Each management transaction takes up to a millisecond, during
+		 * which the entrypoint would not serve the rings. Hence, a periodic
+		 * poll only checks BMSR without waiting, and the complete link state
+		 * is read only if the link may have changed.
+		 */
+		enum { LINK_DOWN_POLL_US = 100 * 1000, LINK_UP_POLL_US = 1000 * 1000 };
+
+		/* the session's link is up as long as any of the ports is up */
+		bool _link_up { false };
 
-		/************************
-		 ** Buffer descriptors **
-		 ************************/
+		Timer::One_shot_timeout<Uplink_client> _link_timeout;
 
-		struct Tx_descriptor : Register_array<0x400, 64, TX, 64>
+		void _update_link_state()
 		{
-			struct Crc   : Bitfield<11, 1>  { }; /* CRC enable */
-			struct Pad   : Bitfield<12, 1>  { }; /* PAD short packets */
-			struct Wr    : Bitfield<13, 1>  { }; /* wrap */
-			struct Irq   : Bitfield<14, 1>  { }; /* Raise IRQ */
-			struct Rd    : Bitfield<15, 1>  { }; /* Descriptor is ready */
-			struct Len   : Bitfield<16, 16> { }; /* length */
-			struct Txpnt : Bitfield<32, 32> { }; /* buffer pointer */
-		};
+			bool up = false, all_up = true;
+
+			_for_each_port([&] (Nic_port &port) {
+
+				Phy::Link const link = port.phy.link_state();
+
+				if (link != port.link) {
+					port.link = link;
+					log(port.name, ": link ", port.link);
+					port.nic.configure_link(port.link);
+				}
+
+				up     |= port.link.up;
+				all_up &= port.link.up;
+			});
 
-		struct Rx_descriptor : Register_array<0x400 + TX * 8, 64, RX, 64>
+			if (up != _link_up) {
+				_link_up = up;
+				_drv_handle_link_state(_link_up);
+			}
+
+			_link_timeout.schedule(Microseconds(all_up ? LINK_UP_POLL_US
+			                                           : LINK_DOWN_POLL_US));
+		}
+
+		void _handle_link_timeout(Duration)
 		{
-			struct Wr    : Bitfield<13, 1>  { }; /* wrap */
-			struct Irq   : Bitfield<14, 1>  { }; /* Raise IRQ */
-			struct E     : Bitfield<15, 1>  { }; /* Empty (0 = data, 1 = empty) */
-			struct Len   : Bitfield<16, 16> { }; /* length */
-			struct Rxpnt : Bitfield<32, 32> { }; /* buffer pointer */
-		};
+			bool changed = false, all_up = true;
+
+			_for_each_port([&] (Nic_port &port) {
+				changed |= port.phy.link_changed(port.link);
+				all_up  &= port.link.up;
+			});
 
-		unsigned _tx_index() const { return _current_tx; }
-		unsigned _rx_index() const { return _current_rx; }
-		unsigned _tx_next()  const { return (_tx_index() + 1) % TX; }
-		unsigned _rx_next()  const { return (_rx_index() + 1) % RX; }
+			if (changed) {
+				_update_link_state();
+				return;
+			}
 
-		void *_transmit_buffer(unsigned index)
+			_link_timeout.schedule(Microseconds(all_up ? LINK_UP_POLL_US
+			                                           : LINK_DOWN_POLL_US));
+		}
+
+		Timer::One_shot_timeout<Uplink_client> _poll_timeout;
+
+		/*
+		 * TX watchdog
+		 *
+		 * A port whose TX ring had frames pending at two consecutive checks,
+		 * one watchdog period apart, without any completion in between is
+		 * considered stuck. Only its descriptor rings are reset, the PHY and
+		 * the link stay as they are. Ports without link are not checked.
+		 */
+		Timer::One_shot_timeout<Uplink_client> _tx_watchdog;
+
+		static uint64_t _tx_completions(Opencores::Statistics const &stats)
 		{
-			addr_t begin = (addr_t)_dma_mem.local_addr();
-			return (void *)(begin + index * 0x800);
+			return stats.tx_packets + stats.tx_carrier + stats.tx_collisions
+			     + stats.tx_underruns;
 		}
 
-		void *_receive_buffer(unsigned index)
+		void _handle_tx_watchdog(Duration)
 		{
-			addr_t begin = (addr_t)_dma_mem.local_addr() + TX * 0x800;
-			return (void *)(begin + index * 0x800);
+			_for_each_port([&] (Nic_port &port) {
+
+				/* a staged frame stays with the driver until flushed */
+				port.nic.flush_transmit();
+
+				/* completions may be pending without interrupt, see 'transmit' */
+				_handle_tx_completion(port);
+
+				/*
+				 * A frame submitted shortly before the check had no chance to
+				 * complete yet. Hence, the ring is stuck only if frames were
+				 * pending at the previous check already and none completed
+				 * since.
+				 */
+				uint64_t const progress = _tx_completions(port.nic.statistics());
+				unsigned const used     = port.nic.tx_ring_used();
+				bool     const stuck    = port.link.up && used && port.tx_used
+				                       && progress == port.tx_progress;
+
+				port.tx_progress = progress;
+				port.tx_used     = stuck ? 0 : used;
+
+				if (!stuck) return;
+
+				warning(port.name, ": TX stalled, dropping ",
+				        port.nic.tx_ring_used(), " frames and resetting rings");
+				port.nic.reset_rings();
+			});
+
+			_resume_tx();
+
+			if (_settings.tx_timeout.value)
+				_tx_watchdog.schedule(_settings.tx_timeout);
 		}
 
-		void _setup_transmit_buffer(uint32_t address, unsigned index)
+		/*
+		 * Busy polling
+		 *
+		 * Each pass over the rings submits the signal for the next pass. The
+		 * entrypoint thereby spins on the rings, but still dispatches the
+		 * signals of the Uplink session and of timeouts in between. All
+		 * driver state stays confined to the entrypoint.
+		 */
+		Signal_handler<Uplink_client> _busy_poll_handler {
+			_env.ep(), *this, &Uplink_client::_handle_busy_poll };
+
+		Trace::Timestamp _busy_poll_submitted { 0 };
+
+		bool _busy_polling() const {
+			return _settings.polling.mode == Polling::Mode::BUSY_POLL; }
+
+		void _submit_busy_poll()
 		{
-			write<Tx_descriptor>(0, index);
-			write<Tx_descriptor::Txpnt>(address, index);
+			_busy_poll_submitted = _stamp();
+			Signal_transmitter(_busy_poll_handler).submit();
 		}
 
-		void _setup_receive_buffer(uint32_t address, unsigned index)
+		/*
+		 * The Uplink base class drains the packet stream without telling
+		 * the driver where a batch ends. The first accepted frame of a batch
+		 * therefore submits a local signal, whose handler runs once the
+		 * packet-stream handler returned and hands the last frame of the
+		 * batch to the NIC with a completion interrupt.
+		 */
+		Signal_handler<Uplink_client> _tx_flush_handler {
+			_env.ep(), *this, &Uplink_client::_handle_tx_flush };
+
+		bool _tx_flush_submitted { false };
+
+		void _handle_tx_flush()
 		{
-			write<Rx_descriptor>(0, index);
-			Rx_descriptor::access_t descr = read<Rx_descriptor>(index);
-			Rx_descriptor::Irq::set(descr, 1);
-			Rx_descriptor::Rxpnt::set(descr, address);
-			write<Rx_descriptor>(descr, index);
-			write<Rx_descriptor::E>(1, index);
+			_tx_flush_submitted = false;
+			_for_each_port([&] (Nic_port &port) { port.nic.flush_transmit(); });
 		}
 
+		/**
+		 * Resume transmission of pending packets after ring space freed up
+		 */
+		void _resume_tx()
+		{
+			if (!_tx_stalled) return;
 
-		/******************
-		 ** PHY handling **
-		 ******************/
+			_tx_stalled = false;
 
-		enum Phy_address {
-			BMCR = 0x0,  /* basic mode control */
-			BMSR = 0x1,  /* basic mode status  */
-			MICR = 0x11  /* MII IRQ control    */
-		};
+			if (_conn.constructed())
+				_conn_rx_handle_packet_avail();
+		}
 
-		void _phy_write_transaction()
+		/**
+		 * Reclaim TX descriptors and record their latency
+		 *
+		 * \return  number of reclaimed descriptors
+		 */
+		unsigned _reclaim_transmitted(Nic_port &port)
 		{
-			wait_for(_delayer, Miistatus::Busy::Equal(0));
-			write<Miicommand::Wtrldata>(1);
-			wait_for(_delayer, Miistatus::Busy::Equal(0));
-			write<Miicommand::Wtrldata>(0);
+			Trace::Timestamp const now = _stamp();
+
+			return port.nic.reclaim_transmitted([&] (unsigned const index) {
+				if (now && port.tx_stamp[index])
+					_latency.tx_reclaim.record(now - port.tx_stamp[index]); });
 		}
 
-		void _phy_read_transaction()
+		/**
+		 * Reclaim TX descriptors and resume a stalled transmission
+		 *
+		 * \return  number of reclaimed descriptors
+		 */
+		unsigned _handle_tx_completion(Nic_port &port)
 		{
-			wait_for(_delayer, Miistatus::Busy::Equal(0));
-			write<Miicommand::Rstat>(1);
-			wait_for(_delayer, Miistatus::Busy::Equal(0));
-			write<Miicommand::Rstat>(0);
+			unsigned const count = _reclaim_transmitted(port);
+
+			if (count)
+				_resume_tx();
+
+			return count;
 		}
 
-		void _phy_reset()
+		/**
+		 * Forward up to 'budget' received frames of 'port' to the Uplink session
+		 *
+		 * \return  number of harvested frames
+		 */
+		unsigned _handle_rx(Nic_port &port, unsigned const budget)
 		{
-			enum { PHY_RESET = 0x8000 };
+			if (_settings.rx_batch && _conn.constructed())
+				return _handle_rx_batch(port, budget);
 
-			write<Miiaddress::Rgad>(BMCR);          /* basic mode control (BCMR) */
-			write<Miitx_data::Ctrldata>(PHY_RESET); /* BCMR phy reset */
-			_phy_write_transaction();
-			unsigned retry = 0;
-			write<Miimoder::Miinopre>(0);
-			_phy_read_transaction();
-			write<Miimoder::Miinopre>(1);
-			while (read<Miirx_data::Prsd>() & PHY_RESET && retry++ < 20)
+			auto forward_fn = [&] (void const *frame, size_t length)
 			{
-				_phy_read_transaction();
-			}
+				Trace::Timestamp const harvested = _rx_harvested();
 
-			if (retry >= 20) {
-				Genode::error("PHY reset failed");
-				throw -1;
-			}
+				_drv_rx_handle_pkt(length,
+					[&] (void   *tx_pkt_base,
+					     size_t &tx_pkt_size)
+				{
+					port.nic.copy_received(tx_pkt_base, frame, tx_pkt_size);
+					_capture_frame(port, Capture::Direction::RX, tx_pkt_base, tx_pkt_size);
+					return Write_result::WRITE_SUCCEEDED;
+				});
+
+				if (harvested)
+					_latency.rx_handoff.record(Trace::timestamp() - harvested);
+			};
+
+			unsigned count = 0;
+			while (count < budget && port.nic.with_received_frame(forward_fn))
+				count++;
+
+			port.nic.rx_harvested(count);
+
+			return count;
 		}
 
-		void _phy_init()
+		/*
+		 * Frames that do not fit into the packet stream are dropped, like
+		 * with '_drv_rx_handle_pkt'
+		 */
+		unsigned _handle_rx_batch(Nic_port &port, unsigned const budget)
 		{
-			enum {
-				BMCR_DUPLEX_MODE      = 0x100,
-				BMCR_SPEED_SELECTION  = 0x2000,
-				BMSR_LINK_STATUS      = 0x4,
-			};
+			using Source = Uplink::Session::Tx::Source;
 
+			Source &source = *_conn->tx();
 
-			write<Miiaddress::Rgad>(MICR);
+			/* make room for the batch */
+			while (source.ack_avail())
+				source.release_packet(source.get_acked_packet());
 
-			/* assert interrupt output enable */
-			Miirx_data::access_t micr = read<Miirx_data::Prsd>();
-			micr |= 0x1;
-			write<Miitx_data::Ctrldata>(micr);
-			_phy_write_transaction();
+			unsigned submitted = 0;
 
-			/* full duplex, no auto negotiation, 100 MBit/s */
-			write<Miiaddress::Rgad>(BMCR);
-			write<Miitx_data::Ctrldata>(BMCR_DUPLEX_MODE | BMCR_SPEED_SELECTION);
+			/* the client sees the batch at the wakeup, measured for the first frame */
+			Trace::Timestamp first = 0;
 
-			_phy_write_transaction();
+			auto submit_fn = [&] (void const *frame, size_t length)
+			{
+				Trace::Timestamp const harvested = _rx_harvested();
+				if (!first) first = harvested;
 
-			write<Miiaddress::Rgad>(BMSR);
-			unsigned retry = 0;
-			do {
-				_delayer.usleep(100000);
-				_phy_read_transaction();
-			} while(!(read<Miirx_data::Prsd>() & BMSR_LINK_STATUS) && retry++ < 100);
-			if (retry >= 100) {
-				Genode::error("PHY duplex/speed setup failed\n");
-				throw -1;
-			}
-			log("Link is up: ", read<Miirx_data::Prsd>(), " (BMSR)");
-		}
+				if (!source.ready_to_submit()) return;
 
-	public:
+				try {
+					Packet_descriptor const pkt = source.alloc_packet(length);
+					port.nic.copy_received(source.packet_content(pkt), frame, length);
+					_capture_frame(port, Capture::Direction::RX,
+					               source.packet_content(pkt), length);
 
-		Opencores(Env &env,
-		          Platform::Connection &platform,
-		          Platform::Device &device,
-		          Platform::Device::Mmio<0> &mmio,
-		          Net::Mac_address  mac,
-		          unsigned const    phy_port,
-		          Mmio::Delayer    &delayer)
-		:
-			Mmio(mmio.range()),
-			_env(env), _delayer(delayer), _mac(mac), _phy_port(phy_port),
-			_dma_mem(platform, device)
-		{
-			Moder::access_t moder = 0;
-			Moder::Bro::set(moder, 1);
-			/* promiscuous needs to be set in order to receive broadcasts */
-			Moder::Pro::set(moder, 1);
-			Moder::Ifg::set(moder, 1);
-			Moder::Exdfren::set(moder, 1);
-			Moder::Fulld::set(moder, 1);
-			Moder::NoPre::set(moder, 1);
-			Moder::Crcen::set(moder, 0);
-			write<Moder>(moder);
-
-			/* enable TX/RX interrupts */
-			write<Int_mask>(0);
-			write<Int_mask::Txb>(1);
-			write<Int_mask::Rxb>(1);
-
-			/* set packet gaps to recommented values (eth_speci.pdf) */
-			write<Ipgt>(0x15);
-
-			write<Miiaddress::Fiad>(_phy_port);
-			_configure_mac_address();
-
-			unsigned const div = 10;
-			write<Miimoder::Clkdiv>(div);
-			_phy_reset();
-			_phy_init();
-
-			/* number of TX descriptors */
-			write<Tx_bd::Num>(TX);
-
-			/* fill tx/rx buffer descriptors */
-			uint32_t dma_addr = _dma_mem.dma_addr();
-
-			for (unsigned index = 0; index < TX; index++) {
-				_setup_transmit_buffer(dma_addr + 0x800 * index, index);
-			}
+					if (source.try_submit_packet(pkt))
+						submitted++;
+					else
+						source.release_packet(pkt);
+				}
+				catch (Source::Packet_alloc_failed) { }
+			};
 
-			dma_addr += TX * 0x800;
-			for (unsigned index = 0; index < RX; index++) {
-				_setup_receive_buffer(dma_addr + 0x800 * index, index);
-			}
+			unsigned count = 0;
+			while (count < budget && port.nic.with_received_frame(submit_fn))
+				count++;
 
-			/* set wrap bit for last descriptors */
-			write<Tx_descriptor::Wr>(1, TX - 1);
-			write<Rx_descriptor::Wr>(1, RX - 1);
+			port.nic.rx_harvested(count);
 
-			_enable();
-		}
+			if (submitted) {
+				source.wakeup();
+				_stats.rx_wakeups++;
+
+				if (first)
+					_latency.rx_handoff.record(Trace::timestamp() - first);
+			}
 
-		Net::Mac_address &mac_address() { return _mac; }
+			return count;
+		}
 
-		bool transmit(void const *address, size_t length)
+		/**
+		 * Forward all received frames of 'port', yielding to TX per RX budget
+		 *
+		 * \return  number of harvested frames
+		 */
+		unsigned _handle_rx_interleaved(Nic_port &port)
 		{
-			Tx_descriptor::access_t descr = read<Tx_descriptor>(_tx_index());
+			if (!_settings.rx_budget)
+				return _handle_rx(port, ~0u);
+
+			unsigned total = 0;
+
+			for (;;) {
+				unsigned const count = _handle_rx(port, _settings.rx_budget);
+				total += count;
+
+				if (count < _settings.rx_budget)
+					return total;
 
-			if (Tx_descriptor::Rd::get(descr)) return false;
+				_stats.rx_yields++;
 
-			memcpy(_transmit_buffer(_tx_index()), address, length);
+				/* free TX descriptors and submit the client's pending packets */
+				_for_each_port([&] (Nic_port &tx_port) { _handle_tx_completion(tx_port); });
 
-			Tx_descriptor::Pad::set(descr, 1);
-			Tx_descriptor::Crc::set(descr, 1);
-			Tx_descriptor::Len::set(descr, length);
-			Tx_descriptor::Rd::set(descr, 1);
-			Tx_descriptor::Irq::set(descr, 1);
+				if (_conn.constructed())
+					_conn_rx_handle_packet_avail();
+			}
+		}
 
-			write<Tx_descriptor>(descr, _tx_index());
+		unsigned _harvest(unsigned const budget)
+		{
+			unsigned count = 0;
 
-			_current_tx = _tx_next();
+			_for_each_port([&] (Nic_port &port) {
+				port.nic.update_rx_busy();
+				_handle_tx_completion(port);
+				count += (budget == ~0u) ? _handle_rx_interleaved(port)
+				                         : _handle_rx(port, budget);
+			});
 
-			return true;
+			return count;
 		}
 
-		bool receive_ready() const
+		void _irq_enabled(bool const enabled)
 		{
-			return read<Rx_descriptor::E>(_rx_index()) == 0;
+			_for_each_port([&] (Nic_port &port) { port.nic.irq_enabled(enabled); });
 		}
 
-		size_t receive_length() const
+		void _enter_polling()
 		{
-			return (size_t)read<Rx_descriptor::Len>(_rx_index());
+			_irq_enabled(false);
+			_polling_active = true;
+			_idle_polls     = 0;
+			_poll_timeout.schedule(Microseconds(_settings.polling.interval_us));
 		}
 
-		void receive(void *address, size_t &length)
+		void _leave_polling()
 		{
-			size_t rx_length = (size_t)read<Rx_descriptor::Len>(_rx_index());
-			if (rx_length < length)
-				length = rx_length;
+			_polling_active = false;
+			_irq_enabled(true);
 
-			memcpy(address, _receive_buffer(_rx_index()), length);
-			write<Rx_descriptor::E>(1, _rx_index());
-			_current_rx = _rx_next();
+			/* catch frames that arrived while re-enabling interrupts */
+			_harvest(~0u);
 		}
 
-		template <typename TX_FN, typename RX_FN>
-		void with_irq(TX_FN const tx_fn, RX_FN const rx_fn)
+		void _handle_poll(Duration)
 		{
-			Int_source::access_t source = read<Int_source>();
+			if (!_polling_active) return;
 
-			if (Int_source::Rxb::get(source))
-				rx_fn();
+			_stats.polls++;
 
-			if (Int_source::Txb::get(source))
-				tx_fn();
+			if (_harvest(_settings.polling.budget))
+				_idle_polls = 0;
+			else if (++_idle_polls >= _settings.polling.idle) {
+				_leave_polling();
+				return;
+			}
 
-			write<Int_source>(source);
+			_poll_timeout.schedule(Microseconds(_settings.polling.interval_us));
 		}
-};
 
+		void _handle_busy_poll()
+		{
+			/* signal submitted before leaving busy polling */
+			if (!_busy_polling()) return;
 
-template<typename T>
-class Genode::Uplink_client : public Signal_handler<Uplink_client<T>>,
-                              public Uplink_client_base
-{
-	private:
+			if (_busy_poll_submitted)
+				_latency.poll_signal.record(Trace::timestamp() - _busy_poll_submitted);
 
-		Opencores &_nic;
-		T         &_obj;
-		void      (T::*_ack_irq) ();
+			_harvest(~0u);
+			_submit_busy_poll();
+		}
 
-		void _handle_irq()
+		/*
+		 * Hash of the Ethernet addresses, and of the IPv4 addresses and
+		 * TCP/UDP ports if present, such that the frames of a flow are
+		 * transmitted in order via the same port
+		 */
+		static uint32_t _flow_hash(uint8_t const *frame, size_t const size)
 		{
-			auto tx_fn = [&]()
-			{
-				/* poke uplink client */
-				_conn_rx_handle_packet_avail();
-			};
+			enum { ETH_HDR = 14, IPV4_SRC = ETH_HDR + 12, IPV4_PROTO = ETH_HDR + 9 };
 
-			auto rx_fn = [&] ()
-			{
-				while (_nic.receive_ready()) {
-					_drv_rx_handle_pkt(
-						_nic.receive_length(),
-						[&] (void   *tx_pkt_base,
-						     size_t &tx_pkt_size)
-					{
-						_nic.receive(tx_pkt_base, tx_pkt_size);
-						return Write_result::WRITE_SUCCEEDED;
-					});
-				}
-			};
+			uint32_t hash = 0;
 
-			_nic.with_irq(tx_fn, rx_fn);
+			auto mix = [&] (uint8_t const *data, size_t const length) {
+				for (size_t i = 0; i < length; i++)
+					hash = hash * 31 + data[i]; };
 
-			/* ack IRQ controller */
-			(_obj.*_ack_irq)();
+			if (size < ETH_HDR) return hash;
+
+			mix(frame, 12);
+
+			bool const ipv4 = frame[12] == 0x08 && frame[13] == 0x00;
+			if (!ipv4 || size < ETH_HDR + 20) return hash;
+
+			mix(frame + IPV4_SRC, 8);
+
+			size_t  const ihl   = (frame[ETH_HDR] & 0xf) * 4;
+			uint8_t const proto = frame[IPV4_PROTO];
+
+			if ((proto == 6 || proto == 17) && size >= ETH_HDR + ihl + 4)
+				mix(frame + ETH_HDR + ihl, 4);
+
+			return hash;
+		}
+
+		/*
+		 * Select the port for transmission among the ports with link
+		 */
+		Nic_port &_tx_port(void const *frame, size_t const size)
+		{
+			if (_ports.count == 1)
+				return *_ports.port[0];
+
+			Nic_port *up[MAX_PORTS] { };
+			unsigned  up_count = 0;
+
+			_for_each_port([&] (Nic_port &port) {
+				if (port.link.up) up[up_count++] = &port; });
+
+			if (!up_count)
+				return *_ports.port[0];
+
+			return *up[_flow_hash((uint8_t const *)frame, size) % up_count];
+		}
+
+		static void _generate(Generator &g, Opencores::Statistics const &stats)
+		{
+			g.node("rx", [&] {
+				g.attribute("packets",    stats.rx_packets);
+				g.attribute("bytes",      stats.rx_bytes);
+				g.attribute("errors",     stats.rx_errors);
+				g.attribute("overruns",   stats.rx_overruns);
+				g.attribute("busy",       stats.rx_busy);
+				g.attribute("high_water", stats.rx_ring_high_water);
+			});
+			g.node("tx", [&] {
+				g.attribute("packets",    stats.tx_packets);
+				g.attribute("bytes",      stats.tx_bytes);
+				g.attribute("carrier",    stats.tx_carrier);
+				g.attribute("collisions", stats.tx_collisions);
+				g.attribute("underruns",  stats.tx_underruns);
+				g.attribute("irqs",       stats.tx_irqs);
+				g.attribute("resets",     stats.tx_resets);
+				g.attribute("dropped",    stats.tx_dropped);
+				g.attribute("high_water", stats.tx_ring_high_water);
+			});
+		}
+
+		static void _generate(Generator &g, Nic_port const &port)
+		{
+			g.node("link", [&] {
+				g.attribute("up", port.link.up);
+				if (!port.link.up) return;
+				g.attribute("speed", port.link.speed);
+				g.attribute("duplex", port.link.full_duplex ? "full" : "half");
+			});
+			_generate(g, port.nic.statistics());
 		}
 
 		Transmit_result
 		_drv_transmit_pkt(const char *conn_rx_pkt_base,
 		                  size_t conn_rx_pkt_size) override
 		{
-			if (_nic.transmit(conn_rx_pkt_base, conn_rx_pkt_size))
+			Nic_port  &port = _tx_port(conn_rx_pkt_base, conn_rx_pkt_size);
+			Opencores &nic  = port.nic;
+
+			/* not resuming, the packet stream is drained already */
+			if (nic.tx_ring_full())
+				_reclaim_transmitted(port);
+
+			unsigned const slot = nic.tx_slot();
+
+			/* the end of the batch is handled by '_handle_tx_flush' */
+			if (nic.transmit(conn_rx_pkt_base, conn_rx_pkt_size, true)) {
+
+				if (!_tx_flush_submitted) {
+					_tx_flush_submitted = true;
+					Signal_transmitter(_tx_flush_handler).submit();
+				}
+
+				port.tx_stamp[slot] = _stamp();
+				_capture_frame(port, Capture::Direction::TX,
+				               conn_rx_pkt_base, conn_rx_pkt_size);
 				return Transmit_result::ACCEPTED;
+			}
 
+			_tx_stalled = true;
+			_stats.retries++;
 			return Transmit_result::RETRY;
 		}
 
 	public:
 
-		Uplink_client(Env &env, Allocator &alloc, Opencores &nic,
-		              T &obj, void (T::*ack_irq)())
+		Uplink_client(Env &env, Allocator &alloc, Ports const &ports,
+		              Timer::Connection &timer, Settings const &settings,
+		              Capture::Writer *capture, Session_label const &label)
 		:
-			Signal_handler<Uplink_client>(env.ep(), *this, &Uplink_client::_handle_irq),
-			Uplink_client_base(env, alloc, nic.mac_address()),
-			_nic(nic), _obj(obj), _ack_irq(ack_irq)
+			Uplink_client_base(env, alloc, ports.port[0]->nic.mac_address(), label),
+			_env(env), _ports(ports), _settings(settings), _capture(capture),
+			_link_timeout(timer, *this, &Uplink_client::_handle_link_timeout),
+			_poll_timeout(timer, *this, &Uplink_client::_handle_poll),
+			_tx_watchdog(timer, *this, &Uplink_client::_handle_tx_watchdog)
 		{
-			_drv_handle_link_state(true);
+			_for_each_port([&] (Nic_port &port) { port.irq_handler(*this); });
+
+			_update_link_state();
+
+			if (_settings.tx_timeout.value)
+				_tx_watchdog.schedule(_settings.tx_timeout);
+
+			if (_busy_polling()) {
+				_irq_enabled(false);
+				_submit_busy_poll();
+				return;
+			}
+
+			/* a previous client of the ports may have left interrupts masked */
+			_irq_enabled(true);
+			_harvest(~0u);
+		}
+
+		/*
+		 * A flush signal still pending dies with the client, so the last
+		 * staged frame is handed to the NIC here
+		 */
+		~Uplink_client() { _handle_tx_flush(); }
+
+		/**
+		 * Apply new settings without re-opening the Uplink session
+		 */
+		void configure(Settings const &settings)
+		{
+			bool const busy_poll = _busy_polling();
+			bool const watchdog  = _settings.tx_timeout.value;
+
+			_settings = settings;
+
+			if (_polling_active && _settings.polling.mode != Polling::Mode::ADAPTIVE)
+				_leave_polling();
+
+			if (_busy_polling() && !busy_poll) {
+				_irq_enabled(false);
+				_submit_busy_poll();
+			}
+
+			/* catch frames that arrived while leaving busy polling */
+			if (!_busy_polling() && busy_poll) {
+				_irq_enabled(true);
+				_harvest(~0u);
+			}
+
+			if (!_settings.tx_timeout.value)
+				_tx_watchdog.discard();
+			else if (!watchdog) {
+				_for_each_port([&] (Nic_port &port) { port.tx_used = 0; });
+				_tx_watchdog.schedule(_settings.tx_timeout);
+			}
+
+			/* ring resets may have freed up TX descriptors */
+			_resume_tx();
+		}
+
+		/**
+		 * Nic_port::Irq_handler interface
+		 */
+		void handle_irq(Nic_port &port) override
+		{
+			Trace::Timestamp const entry = _stamp();
+			_irq_entry = entry;
+
+			unsigned received    = 0;
+			unsigned transmitted = 0;
+
+			auto tx_fn = [&] () { transmitted = _handle_tx_completion(port); };
+			auto rx_fn = [&] () { received    = _handle_rx_interleaved(port); };
+
+			port.nic.with_irq(tx_fn, rx_fn);
+
+			_stats.irq(received + transmitted);
+
+			if (entry) {
+				_latency.irq_service.record(Trace::timestamp() - entry);
+				_irq_entry = 0;
+			}
+
+			if (_settings.polling.mode == Polling::Mode::ADAPTIVE && !_polling_active
+			 && received >= _settings.polling.threshold)
+				_enter_polling();
+		}
+
+		/**
+		 * Generate statistics report
+		 *
+		 * \param ticks_per_ms  rate of 'Trace::timestamp' for latencies
+		 */
+		void generate_statistics(Generator &g, uint64_t const ticks_per_ms) const
+		{
+			if (_ports.count == 1)
+				_generate(g, *_ports.port[0]);
+			else
+				_for_each_port([&] (Nic_port const &port) {
+					g.node("port", [&] {
+						g.attribute("name", port.name);
+						_generate(g, port);
+					});
+				});
+
+			_stats.generate(g);
+
+			if (_settings.latency)
+				_latency.generate(g, ticks_per_ms);
 		}
 };
 
@@ -544,6 +1280,8 @@ class Main
 {
 	private:
 
+		enum { MAX_PORTS = Uplink_client::MAX_PORTS };
+
 		Env &_env;
 
 		struct Timer_delayer : Mmio<0>::Delayer, Timer::Connection
@@ -557,17 +1295,94 @@ class Main
 
 		Attached_rom_dataspace _config_rom { _env, "config" };
 
-		Platform::Connection      _platform { _env };
-		Platform::Device          _device   { _platform };
-		Platform::Device::Mmio<0> _mmio     { _device };
-		Platform::Device::Irq     _irq      { _device };
+		/*
+		 * Timer for interrupt moderation, link monitoring, and reports, kept
+		 * separate from the delayer because blocking 'usleep' calls would
+		 * re-program a shared timeout
+		 */
+		Timer::Connection _timer { _env };
+
+		/*
+		 * Reference point for the rate of 'Trace::timestamp', which is
+		 * determined at each report instead of blocking at startup
+		 */
+		uint64_t         const _calibration_us    { _timer.curr_time().trunc_to_plain_us().value };
+		Trace::Timestamp const _calibration_ticks { Trace::timestamp() };
+
+		Platform::Connection _platform { _env };
+		Heap                 _heap     { _env.ram(), _env.rm() };
+
+		Opencores::Geometry const _geometry { _read_geometry(_config_rom.node()) };
+
+		/*
+		 * All ports share the DMA memory, each port uses a window of the
+		 * size of the initial ring geometry, which bounds later changes
+		 */
+		Constructible<Platform::Device> _devices[MAX_PORTS] { };
+		Constructible<Dma_mem>          _dma_mem[MAX_PORTS] { };
+		Constructible<Nic_port>         _ports[MAX_PORTS] { };
+		Constructible<Uplink_client>    _uplinks[MAX_PORTS] { };
+
+		unsigned _port_count { 0 };
+
+		/*
+		 * Periodic statistics report, enabled by a '<report>' config node
+		 */
+		Constructible<Expanding_reporter>            _reporter       { };
+		Constructible<Timer::Periodic_timeout<Main>> _report_timeout { };
+
+		void _report_statistics(Duration now)
+		{
+			uint64_t const elapsed_us = now.trunc_to_plain_us().value - _calibration_us;
+			uint64_t const ticks      = Trace::timestamp() - _calibration_ticks;
 
-		Opencores           _nic    { _env, _platform, _device, _mmio,
-		                              _read_mac(_config_rom.node()),
-		                              _read_port(_config_rom.node()),
-		                              _delayer };
-		Heap                _heap   { _env.ram(), _env.rm() };
-		Uplink_client<Main> _uplink { _env, _heap, _nic, *this, &Main::ack };
+			uint64_t const ticks_per_ms = elapsed_us ? ticks * 1000 / elapsed_us : 0;
+
+			/*
+			 * Unbonded ports have an Uplink client each, whose report is
+			 * wrapped in a '<port>' node to tell the clients apart
+			 */
+			bool const per_port = !_bond && _port_count > 1;
+
+			_reporter->generate([&] (Generator &g) {
+				for (unsigned i = 0; i < MAX_PORTS; i++) {
+
+					if (!_uplinks[i].constructed())
+						continue;
+
+					if (!per_port) {
+						_uplinks[i]->generate_statistics(g, ticks_per_ms);
+						continue;
+					}
+
+					g.node("port", [&] {
+						g.attribute("name", _ports[i]->name);
+						_uplinks[i]->generate_statistics(g, ticks_per_ms);
+					});
+				}
+			});
+		}
+
+		void _configure_report(Node const &config)
+		{
+			if (!config.has_sub_node("report")) {
+				_report_timeout.destruct();
+				_reporter.destruct();
+				return;
+			}
+
+			config.with_optional_sub_node("report", [&] (Node const &report) {
+
+				uint64_t const interval_ms =
+					max(report.attribute_value("interval_ms", (uint64_t)1000), (uint64_t)10);
+
+				if (!_reporter.constructed())
+					_reporter.construct(_env, "statistics", "statistics");
+
+				_report_timeout.construct(_timer, *this, &Main::_report_statistics,
+				                          Microseconds(interval_ms * 1000));
+			});
+		}
 
 		static unsigned _read_port(Node const &config) {
 			return config.attribute_value("phy_port", 0u); }
@@ -575,15 +1390,286 @@ class Main
 		static Net::Mac_address _read_mac(Node const &config) {
 			return config.attribute_value("mac", Net::Mac_address(0x2)); }
 
+		static Opencores::Geometry _read_geometry(Node const &config)
+		{
+			Opencores::Geometry const geometry {
+				.tx     = config.attribute_value("tx_descriptors", 64u),
+				.rx     = config.attribute_value("rx_descriptors", 64u),
+				.stride = config.attribute_value("buffer_stride", (size_t)0x800) };
+
+			return geometry.sanitized();
+		}
+
+		/*
+		 * Multicast frames are filtered via the '<multicast mac="..."/>'
+		 * config nodes, or received completely if 'all_multicast' is enabled
+		 */
+		static Opencores::Filter _read_filter(Node const &config)
+		{
+			Opencores::Filter filter {
+				.promiscuous = config.attribute_value("promiscuous", false),
+				.hash        = { 0, 0 } };
+
+			if (config.attribute_value("all_multicast", false)) {
+				filter.hash[0] = filter.hash[1] = ~0u;
+				return filter;
+			}
+
+			config.for_each_sub_node("multicast", [&] (Node const &node) {
+
+				Net::Mac_address const mac =
+					node.attribute_value("mac", Net::Mac_address());
+
+				if (!(mac.addr[0] & 1)) {
+					warning("ignoring non-multicast address ", mac);
+					return;
+				}
+
+				filter.add_multicast(mac);
+			});
+
+			return filter;
+		}
+
+		using Device_name = Platform::Device::Name;
+
+		struct Port_config
+		{
+			Nic_port::Config port;
+			Device_name      device;
+		};
+
+		struct Port_configs
+		{
+			Port_config port[MAX_PORTS];
+			unsigned    count;
+			bool        bond;
+		};
+
+		/*
+		 * Without '<port>' nodes, the driver serves the first device with
+		 * the 'phy_port' and 'mac' attributes of the config node. With more
+		 * than one port, each port must name its device, whose platform
+		 * info provides the DMA memory of the port.
+		 */
+		static Port_configs _read_ports(Node const &config)
+		{
+			Port_configs ports { .port = { }, .count = 0, .bond = false };
+
+			config.for_each_sub_node("port", [&] (Node const &node) {
+
+				if (ports.count == MAX_PORTS) {
+					warning("ignoring port configuration beyond ", (unsigned)MAX_PORTS, " ports");
+					return;
+				}
+
+				unsigned const index = ports.count++;
+
+				ports.port[index] = {
+					.port = { .name     = node.attribute_value("name", Nic_port::Name("eth", index)),
+					          .mac      = _read_mac(node),
+					          .phy_port = _read_port(node),
+					          .index    = index },
+					.device = node.attribute_value("device", Device_name()) };
+			});
+
+			for (unsigned i = 0; ports.count > 1 && i < ports.count; i++) {
+				if (ports.port[i].device.valid())
+					continue;
+
+				error(ports.port[i].port.name, ": missing 'device' attribute, "
+				      "serving the first port only");
+				ports.count = 1;
+			}
+
+			if (!ports.count)
+				ports.port[ports.count++] = {
+					.port = { .name     = "eth0",
+					          .mac      = _read_mac(config),
+					          .phy_port = _read_port(config),
+					          .index    = 0 },
+					.device = Device_name() };
+
+			ports.bond = ports.count > 1 && config.attribute_value("bond", false);
+
+			/* bonded ports appear as one interface with the MAC of the first port */
+			if (ports.bond)
+				for (unsigned i = 1; i < ports.count; i++)
+					ports.port[i].port.mac = ports.port[0].port.mac;
+
+			return ports;
+		}
+
+		bool _bond { false };
+
+		Constructible<Capture_service> _capture { };
+
+		Capture::Writer *_capture_writer() {
+			return _capture.constructed() ? &_capture->writer : nullptr; }
+
+		void _construct_capture(Node const &config)
+		{
+			config.with_optional_sub_node("capture", [&] (Node const &capture) {
+
+				size_t const size_kb = max(capture.attribute_value("size_kb", 1024ul), 16ul);
+
+				_capture.construct(_env, _heap, size_kb * 1024,
+				                   capture.attribute_value("snaplen", 128ul));
+			});
+		}
+
+		/*
+		 * Bonded ports share the first Uplink client, a single port keeps
+		 * the unlabeled session of the driver
+		 */
+		void _construct_uplink(unsigned const i, Uplink_client::Settings const &settings)
+		{
+			if (_bond) {
+				Uplink_client::Ports bonded { .port = { }, .count = _port_count };
+				for (unsigned p = 0; p < _port_count; p++)
+					bonded.port[p] = &*_ports[p];
+
+				_uplinks[0].construct(_env, _heap, bonded, _timer, settings,
+				                      _capture_writer(), Session_label());
+				return;
+			}
+
+			_uplinks[i].construct(_env, _heap,
+			                      Uplink_client::Ports { .port = { &*_ports[i] }, .count = 1 },
+			                      _timer, settings, _capture_writer(),
+			                      _port_count > 1 ? Session_label(_ports[i]->name.string())
+			                                      : Session_label());
+		}
+
+		void _construct_ports(Node const &config)
+		{
+			Port_configs const ports = _read_ports(config);
+
+			_port_count = ports.count;
+			_bond       = ports.bond;
+
+			for (unsigned i = 0; i < _port_count; i++)
+				if (ports.port[i].device.valid())
+					_devices[i].construct(_platform, ports.port[i].device);
+				else
+					_devices[i].construct(_platform);
+
+			Dma_mem::Cache const cache = Dma_mem::Cache::from_config(config);
+
+			/* the DMA memory is an I/O memory resource of the port's device */
+			for (unsigned i = 0; i < _port_count; i++)
+				_dma_mem[i].construct(_platform, *_devices[i], ports.port[i].device,
+				                      _geometry.dma_size(), cache);
+
+			Opencores::Filter const filter  = _read_filter(config);
+			bool              const autoneg = config.attribute_value("autoneg", true);
+
+			for (unsigned i = 0; i < _port_count; i++) {
+				_ports[i].construct(_env.ep(), *_devices[i], ports.port[i].port,
+				                    _dma_mem[i]->window(0, _geometry.dma_size()),
+				                    _geometry, filter, autoneg, _delayer);
+				_ports[i]->nic.tx_irq_interval(_read_tx_irq_interval(config));
+			}
+
+			if (_bond)
+				log("bonding ", _port_count, " ports");
+
+			Uplink_client::Settings const settings = Uplink_client::Settings::from_config(config);
+
+			for (unsigned i = 0; i < (_bond ? 1 : _port_count); i++)
+				_construct_uplink(i, settings);
+		}
+
+		static unsigned _read_tx_irq_interval(Node const &config) {
+			return config.attribute_value("tx_irq_interval", 16u); }
+
+		/*
+		 * Apply a config update at runtime
+		 *
+		 * The address filter, the TX interrupt interval, and the ring
+		 * geometry are reprogrammed at the MAC, and the polling settings are
+		 * handed to the Uplink clients. A changed MAC address re-opens the
+		 * Uplink session of the port, which is announced with the address,
+		 * but leaves the PHY and link untouched. The ports themselves, their
+		 * PHY settings, the DMA memory, and frame capture are set up once at
+		 * startup.
+		 */
+		void _apply_config(Node const &config)
+		{
+			Port_configs const ports = _read_ports(config);
+
+			if (ports.count != _port_count || ports.bond != _bond)
+				warning("port changes take effect after restarting the driver");
+
+			Opencores::Filter   const filter   = _read_filter(config);
+			Opencores::Geometry const geometry = _read_geometry(config);
+
+			bool renew[MAX_PORTS] { };
+
+			for (unsigned i = 0; i < _port_count; i++) {
+
+				Opencores &nic = _ports[i]->nic;
+
+				nic.configure_filter(filter);
+				nic.tx_irq_interval(_read_tx_irq_interval(config));
+
+				Opencores::Geometry const &current = nic.geometry();
+				if (geometry.tx != current.tx || geometry.rx != current.rx
+				 || geometry.stride != current.stride) {
+
+					if (!nic.resize_rings(geometry))
+						warning(_ports[i]->name, ": rings exceed DMA memory of ",
+						        _geometry.dma_size(), " bytes, keeping current geometry");
+				}
+
+				Net::Mac_address const mac = (i < ports.count)
+				                           ? ports.port[i].port.mac : nic.mac_address();
+
+				if (mac == nic.mac_address())
+					continue;
+
+				nic.configure_mac_address(mac);
+				renew[_bond ? 0 : i] = true;
+			}
+
+			Uplink_client::Settings const settings = Uplink_client::Settings::from_config(config);
+
+			for (unsigned i = 0; i < MAX_PORTS; i++) {
+
+				if (!_uplinks[i].constructed())
+					continue;
+
+				if (!renew[i]) {
+					_uplinks[i]->configure(settings);
+					continue;
+				}
+
+				_uplinks[i].destruct();
+				_construct_uplink(i, settings);
+			}
+
+			_configure_report(config);
+		}
+
+		Signal_handler<Main> _config_handler {
+			_env.ep(), *this, &Main::_handle_config };
+
+		void _handle_config()
+		{
+			_config_rom.update();
+			_apply_config(_config_rom.node());
+		}
+
 	public:
 
 		Main(Env &env) : _env(env)
 		{
-			_irq.sigh(_uplink);
-			_irq.ack();
-		}
+			_construct_capture(_config_rom.node());
+			_construct_ports(_config_rom.node());
+			_configure_report(_config_rom.node());
 
-		void ack() { _irq.ack(); }
+			_config_rom.sigh(_config_handler);
+		}
 };
 
 
@@ -593,4 +1679,3 @@ void Component::construct(Genode::Env &env)
 
 	static Main main(env);
 }
-
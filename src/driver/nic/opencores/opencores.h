@@ -0,0 +1,968 @@
+/*
+ * \brief  OpenCores Ethernet MAC
+ * \author Sebastian Sumpf
+ * \date   2021-03-05
+ *
+ * The device is driven solely through its register window and a window of
+ * DMA memory, which enables the use of a RAM-backed model of the device
+ * (see 'src/test/opencores_nic').
+ */
+
+/*
+ * Copyright (C) 2021 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#ifndef _SRC__DRIVER__NIC__OPENCORES__OPENCORES_H_
+#define _SRC__DRIVER__NIC__OPENCORES__OPENCORES_H_
+
+#include <base/log.h>
+#include <cpu/memory_barrier.h>
+#include <net/mac_address.h>
+#include <util/misc_math.h>
+#include <util/mmio.h>
+#include <util/string.h>
+
+/* local includes */
+#include <cache.h>
+#include <dma_copy.h>
+#include <phy.h>
+
+namespace Genode { class Opencores; }
+
+
+class Genode::Opencores : Mmio<0x400 + 128 * 8>, public Mdio
+{
+	public:
+
+		enum { MMIO_SIZE = 0x400 + 128 * 8 };
+
+		/*
+		 * Descriptor-ring geometry
+		 *
+		 * The NIC provides 128 buffer descriptors in total, which are split
+		 * between the TX and RX rings. Each descriptor owns a DMA buffer of
+		 * 'stride' bytes, which must hold a maximum-sized frame.
+		 */
+		struct Geometry
+		{
+			enum : unsigned { MAX_DESCRIPTORS = 128 };
+			enum : size_t   { MAX_FRAME = 1536, BUFFER_ALIGN_LOG2 = 6 };
+
+			static_assert((1ul << BUFFER_ALIGN_LOG2) >= Zicbom::MAX_BLOCK_SIZE,
+			              "DMA buffers share cache blocks");
+
+			unsigned tx;
+			unsigned rx;
+			size_t   stride;
+
+			size_t dma_size() const { return (tx + rx) * stride; }
+
+			/**
+			 * Return geometry adjusted to the constraints of the device
+			 */
+			Geometry sanitized() const
+			{
+				Geometry geometry = *this;
+
+				size_t const stride = align_addr(max(geometry.stride, (size_t)MAX_FRAME),
+				                                 BUFFER_ALIGN_LOG2);
+				if (stride != geometry.stride) {
+					warning("buffer stride ", geometry.stride, " adjusted to ", stride);
+					geometry.stride = stride;
+				}
+
+				if (!geometry.tx || !geometry.rx
+				 || geometry.tx + geometry.rx > MAX_DESCRIPTORS) {
+					warning("invalid ring sizes tx=", geometry.tx, " rx=", geometry.rx,
+					        ", using tx=64 rx=64");
+					geometry.tx = 64;
+					geometry.rx = 64;
+				}
+
+				return geometry;
+			}
+		};
+
+		/*
+		 * Memory holding the DMA buffers of all descriptors
+		 *
+		 * Cached DMA buffers of a device that does not snoop the caches
+		 * require explicit cache maintenance around the hand-off of each
+		 * descriptor, which relies on the Zicbom extension of the hart.
+		 */
+		struct Dma_window
+		{
+			addr_t   local_addr;
+			uint32_t dma_addr;         /* the NIC only supports 32-bit addresses */
+			size_t   size;
+			bool     cached;
+			size_t   cache_block_size; /* of cache maintenance, 0 if coherent */
+		};
+
+		/*
+		 * Destination-address filter
+		 *
+		 * Unicast frames are matched against the MAC address and broadcasts
+		 * are always received. Multicast frames are filtered via a 64-bit
+		 * hash of their destination address.
+		 */
+		struct Filter
+		{
+			bool     promiscuous;
+			uint32_t hash[2];
+
+			/*
+			 * The hash index consists of the upper six bits of the
+			 * Ethernet CRC (big endian) of the address
+			 */
+			static unsigned hash_index(Net::Mac_address const &mac)
+			{
+				uint32_t crc = ~0u;
+
+				for (uint8_t octet : mac.addr)
+					for (unsigned bit = 0; bit < 8; bit++, octet >>= 1)
+						crc = (crc << 1) ^ (((crc >> 31) ^ (octet & 1)) ? 0x04c11db7u : 0);
+
+				return crc >> 26;
+			}
+
+			void add_multicast(Net::Mac_address const &mac)
+			{
+				unsigned const index = hash_index(mac);
+				hash[index >> 5] |= 1u << (index & 0x1f);
+			}
+		};
+
+		/*
+		 * Device statistics, updated on descriptor hand-back
+		 */
+		struct Statistics
+		{
+			uint64_t rx_packets    { 0 };
+			uint64_t rx_bytes      { 0 };
+			uint64_t rx_errors     { 0 }; /* CRC, length, symbol errors */
+			uint64_t rx_overruns   { 0 }; /* FIFO overrun of a frame */
+			uint64_t rx_busy       { 0 }; /* frames dropped, no RX descriptor */
+			uint64_t tx_packets    { 0 };
+			uint64_t tx_bytes      { 0 };
+			uint64_t tx_carrier    { 0 }; /* carrier sense lost */
+			uint64_t tx_collisions { 0 }; /* late collision, retry limit */
+			uint64_t tx_underruns  { 0 };
+			uint64_t tx_irqs       { 0 }; /* completion interrupts requested */
+			uint64_t tx_resets     { 0 }; /* ring resets after a TX stall */
+			uint64_t tx_dropped    { 0 }; /* frames discarded by ring resets */
+
+			unsigned rx_ring_high_water { 0 }; /* frames harvested at once */
+			unsigned tx_ring_high_water { 0 }; /* TX descriptors in flight */
+		};
+
+		struct Moder : Register<0x0, 32>
+		{
+			struct RxEn    : Bitfield<0, 1>  { }; /* rx enable */
+			struct TxEn    : Bitfield<1, 1>  { }; /* tx enable */
+			struct NoPre   : Bitfield<2, 1>  { }; /* no preamble */
+			struct Bro     : Bitfield<3, 1>  { }; /* reject broadcast */
+			struct Pro     : Bitfield<5, 1>  { }; /* promiscuous  mode */
+			struct Ifg     : Bitfield<6, 1>  { }; /* Inter frame gap */
+			struct Exdfren : Bitfield<9, 1>  { }; /* Excess defer enabled */
+			struct Fulld   : Bitfield<10, 1> { }; /* Full/Half duplex */
+			struct Rst     : Bitfield<11, 1> { }; /* soft reset */
+			struct Crcen   : Bitfield<13, 1> { }; /* Enable TX CRC */
+		};
+
+		struct Int_source : Register<0x4, 32>
+		{
+			struct Txb  : Bitfield<0, 1> { };
+			struct Txe  : Bitfield<1, 1> { };
+			struct Rxb  : Bitfield<2, 1> { };
+			struct Busy : Bitfield<4, 1> { }; /* frame dropped, no RX buffer */
+		};
+
+		struct Int_mask : Register<0x8, 32>
+		{
+			struct Txb : Bitfield<0, 1> { }; /* transmit frame */
+			struct Txe : Bitfield<1, 1> { }; /* transmit error */
+			struct Rxb : Bitfield<2, 1> { }; /*  receive frame */
+		};
+
+		/* packet gap registers */
+		struct Ipgt  : Register<0xc,  32> { };
+
+		struct Tx_bd : Register<0x20, 32>
+		{
+			/*
+			 * Number of TX buffer descriptors starting at 0x400 (total descriptors
+			 * 128 a 8 byte), RX descriptors follow the TX descriptors
+			 */
+			struct Num : Bitfield<0, 8> { };
+		};
+
+		struct Miimoder : Register<0x28, 32>
+		{
+			struct Miinopre : Bitfield<8, 1> { }; /* nor preamble */
+			struct Clkdiv : Bitfield<0, 8> { };
+		};
+
+		struct Miicommand : Register<0x2c, 32>
+		{
+			struct Rstat    : Bitfield<1, 1> { };
+			struct Wtrldata : Bitfield<2, 1> { };
+		};
+
+		struct Miiaddress : Register<0x30, 32>
+		{
+			struct Fiad : Bitfield<0, 5> { }; /* Phy address */
+			struct Rgad : Bitfield<8, 5> { }; /* register address */
+		};
+
+		struct Miitx_data : Register<0x34, 32>
+		{
+			struct Ctrldata : Bitfield<0, 16> { }; /* control data to PHY */
+		};
+
+		struct Miirx_data : Register<0x38, 32>
+		{
+			struct Prsd : Bitfield<0, 16> { }; /* received data from PHY */
+		};
+
+		struct Miistatus : Register<0x3c, 32>
+		{
+			struct Busy : Bitfield<1, 1> { };
+		};
+
+		/* reverse order 0 = byte 5, 5 = byte 0 */
+		struct Mac_addr : Register_array<0x40, 32, 6, 8> { };
+
+		/* multicast hash table */
+		struct Hash : Register_array<0x48, 32, 2, 32> { };
+
+
+		/************************
+		 ** Buffer descriptors **
+		 ************************/
+
+		struct Tx_descriptor : Register_array<0x400, 64, Geometry::MAX_DESCRIPTORS, 64>
+		{
+			struct Cs    : Bitfield<0, 1>   { }; /* carrier sense lost */
+			struct Lc    : Bitfield<2, 1>   { }; /* late collision */
+			struct Rl    : Bitfield<3, 1>   { }; /* retransmission limit */
+			struct Ur    : Bitfield<8, 1>   { }; /* underrun */
+			struct Crc   : Bitfield<11, 1>  { }; /* CRC enable */
+			struct Pad   : Bitfield<12, 1>  { }; /* PAD short packets */
+			struct Wr    : Bitfield<13, 1>  { }; /* wrap */
+			struct Irq   : Bitfield<14, 1>  { }; /* Raise IRQ */
+			struct Rd    : Bitfield<15, 1>  { }; /* Descriptor is ready */
+			struct Len   : Bitfield<16, 16> { }; /* length */
+			struct Txpnt : Bitfield<32, 32> { }; /* buffer pointer */
+
+			static bool error(access_t const descr)
+			{
+				return Cs::get(descr) || Lc::get(descr) ||
+				       Rl::get(descr) || Ur::get(descr);
+			}
+
+			static void account(access_t const descr, Statistics &stats)
+			{
+				if (!error(descr)) {
+					stats.tx_packets++;
+					stats.tx_bytes += Len::get(descr);
+					return;
+				}
+
+				if (Cs::get(descr))                   stats.tx_carrier++;
+				if (Lc::get(descr) || Rl::get(descr)) stats.tx_collisions++;
+				if (Ur::get(descr))                   stats.tx_underruns++;
+			}
+		};
+
+		/* indexed by RX slot, see '_rx_slot' */
+		struct Rx_descriptor : Register_array<0x400, 64, Geometry::MAX_DESCRIPTORS, 64>
+		{
+			struct Lc    : Bitfield<0, 1>   { }; /* late collision */
+			struct Crc   : Bitfield<1, 1>   { }; /* CRC error */
+			struct Sf    : Bitfield<2, 1>   { }; /* short frame */
+			struct Tl    : Bitfield<3, 1>   { }; /* too long */
+			struct Dn    : Bitfield<4, 1>   { }; /* dribble nibble */
+			struct Is    : Bitfield<5, 1>   { }; /* invalid symbol */
+			struct Or    : Bitfield<6, 1>   { }; /* overrun */
+			struct Wr    : Bitfield<13, 1>  { }; /* wrap */
+			struct Irq   : Bitfield<14, 1>  { }; /* Raise IRQ */
+			struct E     : Bitfield<15, 1>  { }; /* Empty (0 = data, 1 = empty) */
+			struct Len   : Bitfield<16, 16> { }; /* length */
+			struct Rxpnt : Bitfield<32, 32> { }; /* buffer pointer */
+
+			static void account(access_t const descr, Statistics &stats)
+			{
+				stats.rx_packets++;
+				stats.rx_bytes += Len::get(descr);
+
+				if (Or::get(descr)) stats.rx_overruns++;
+
+				if (Lc::get(descr) || Crc::get(descr) || Sf::get(descr)
+				 || Tl::get(descr) || Dn::get(descr)  || Is::get(descr))
+					stats.rx_errors++;
+			}
+		};
+
+	private:
+
+		Mmio::Delayer &  _delayer;
+		Net::Mac_address _mac;
+
+		/*
+		 * PHY=1 for Qemu, PHY=0 for MiG-V Eth0, and PHY=1 for MiG-V Eth1
+		 */
+		const unsigned _phy_port;
+
+		Geometry         _geometry;
+		Dma_window const _dma;
+
+		unsigned _current_tx { 0 }; /* next TX descriptor to fill         */
+		unsigned _tx_done    { 0 }; /* oldest TX descriptor owned by NIC  */
+		unsigned _tx_pending { 0 }; /* TX descriptors owned by NIC        */
+		unsigned _current_rx { 0 };
+
+		/*
+		 * A TX completion interrupt is requested for the last frame of a
+		 * batch, for every 'interval' frames, and if the ring is full
+		 *
+		 * Whether a frame is the last of a batch is known only when the
+		 * next frame or the end of the batch arrives. Hence, the descriptor
+		 * of a frame that may be followed by more frames is staged, i.e.,
+		 * filled but not yet handed to the NIC, see 'flush_transmit'.
+		 */
+		unsigned _tx_irq_interval { 1 };
+		unsigned _tx_since_irq    { 0 };
+		bool     _tx_staged       { false }; /* descriptor before '_current_tx' */
+		size_t   _tx_staged_len   { 0 };
+
+		/*
+		 * Software shadow of the descriptor rings
+		 *
+		 * Each descriptor access is an uncached bus transaction. The static
+		 * part of every descriptor (buffer pointer, wrap and IRQ bits) is
+		 * kept in RAM, so handing a descriptor to the NIC is a single 64-bit
+		 * write without a prior read. A descriptor the NIC has returned is
+		 * read once and its value is kept until the driver hands it back,
+		 * as the NIC does not touch it in between.
+		 */
+		Tx_descriptor::access_t _tx_shadow[Geometry::MAX_DESCRIPTORS] { };
+		Rx_descriptor::access_t _rx_shadow[Geometry::MAX_DESCRIPTORS] { };
+
+		template <typename DESCR>
+		struct Returned
+		{
+			typename DESCR::access_t value { 0 };
+			bool                     valid { false };
+		};
+
+		Returned<Tx_descriptor> _tx_returned { }; /* at '_tx_done'    */
+		Returned<Rx_descriptor> _rx_returned { }; /* at '_current_rx' */
+
+		Statistics _stats { };
+
+		void _configure_mac_address()
+		{
+			for (unsigned i = 0; i < 6; i++) {
+				write<Mac_addr>(_mac.addr[5 - i], i);
+			}
+		}
+
+		void _enable()
+		{
+			write<Moder::TxEn>(1);
+			write<Moder::RxEn>(1);
+		}
+
+		/*
+		 * Cache maintenance, no-ops for uncached and coherent DMA memory
+		 */
+
+		void _dma_clean(void const *addr, size_t size) const
+		{
+			if (_dma.cache_block_size) Zicbom::clean(addr, size, _dma.cache_block_size);
+		}
+
+		void _dma_invalidate(void const *addr, size_t size) const
+		{
+			if (_dma.cache_block_size) Zicbom::invalidate(addr, size, _dma.cache_block_size);
+		}
+
+		/*
+		 * Uncached DMA buffers are accessed by whole words only, the padding
+		 * of the last word stays within the buffer because the stride is a
+		 * multiple of the buffer alignment
+		 */
+
+		void _copy_to_buffer(void *buffer, void const *src, size_t size) const
+		{
+			if (_dma.cached) memcpy(buffer, src, size);
+			else             Dma_copy::to_device(buffer, src, size);
+		}
+
+		unsigned _tx_index() const { return _current_tx; }
+		unsigned _rx_index() const { return _current_rx; }
+		unsigned _tx_next()  const { return (_tx_index() + 1) % _geometry.tx; }
+		unsigned _tx_done_next() const { return (_tx_done + 1) % _geometry.tx; }
+		unsigned _tx_prev()  const { return (_tx_index() + _geometry.tx - 1) % _geometry.tx; }
+		unsigned _rx_next()  const { return (_rx_index() + 1) % _geometry.rx; }
+
+		/* RX descriptors and buffers follow the TX ones */
+		unsigned _rx_slot(unsigned index) const { return _geometry.tx + index; }
+
+		void *_transmit_buffer(unsigned index)
+		{
+			return (void *)(_dma.local_addr + index * _geometry.stride);
+		}
+
+		uint32_t _transmit_dma_addr(unsigned index)
+		{
+			return _dma.dma_addr + uint32_t(index * _geometry.stride);
+		}
+
+		void *_receive_buffer(unsigned index)
+		{
+			return (void *)(_dma.local_addr + _rx_slot(index) * _geometry.stride);
+		}
+
+		uint32_t _receive_dma_addr(unsigned index)
+		{
+			return _dma.dma_addr + uint32_t(_rx_slot(index) * _geometry.stride);
+		}
+
+		void _setup_transmit_buffer(unsigned index)
+		{
+			Tx_descriptor::access_t descr = 0;
+			Tx_descriptor::Wr::set(descr, index == _geometry.tx - 1);
+			Tx_descriptor::Txpnt::set(descr, _transmit_dma_addr(index));
+			Tx_descriptor::Pad::set(descr, 1);
+			Tx_descriptor::Crc::set(descr, 1);
+
+			_tx_shadow[index] = descr;
+
+			/* not ready until 'transmit' */
+			write<Tx_descriptor>(descr, index);
+		}
+
+		void _setup_receive_buffer(unsigned index)
+		{
+			Rx_descriptor::access_t descr = 0;
+			Rx_descriptor::Wr::set(descr, index == _geometry.rx - 1);
+			Rx_descriptor::Irq::set(descr, 1);
+			Rx_descriptor::Rxpnt::set(descr, _receive_dma_addr(index));
+			Rx_descriptor::E::set(descr, 1);
+
+			/* dirty blocks must not be written back over received frames */
+			_dma_invalidate(_receive_buffer(index), _geometry.stride);
+
+			_rx_shadow[index] = descr;
+			write<Rx_descriptor>(descr, _rx_slot(index));
+		}
+
+		/*
+		 * The soft reset returns all registers to their defaults and the
+		 * descriptor pointers of the MAC to the start of the rings. The
+		 * configuration is read back before and restored afterwards.
+		 */
+		void _reset_rings()
+		{
+			Moder::access_t    moder    = read<Moder>();
+			Int_mask::access_t int_mask = read<Int_mask>();
+			Ipgt::access_t     ipgt     = read<Ipgt>();
+			Miimoder::access_t miimoder = read<Miimoder>();
+			Hash::access_t     hash[2]  = { read<Hash>(0), read<Hash>(1) };
+
+			write<Moder>(Moder::Rst::bits(1));
+			_delayer.usleep(1);
+			write<Moder>(0);
+
+			Moder::TxEn::set(moder, 0);
+			Moder::RxEn::set(moder, 0);
+			write<Moder>(moder);
+
+			write<Int_mask>(int_mask);
+			write<Ipgt>(ipgt);
+			write<Miimoder>(miimoder);
+			write<Hash>(hash[0], 0);
+			write<Hash>(hash[1], 1);
+			write<Miiaddress::Fiad>(_phy_port);
+			_configure_mac_address();
+
+			_stats.tx_dropped += tx_ring_used();
+
+			write<Tx_bd::Num>(_geometry.tx);
+
+			for (unsigned index = 0; index < _geometry.tx; index++)
+				_setup_transmit_buffer(index);
+
+			for (unsigned index = 0; index < _geometry.rx; index++)
+				_setup_receive_buffer(index);
+
+			_current_tx   = 0;
+			_tx_done      = 0;
+			_tx_pending   = 0;
+			_tx_since_irq = 0;
+			_tx_staged    = false;
+			_current_rx   = 0;
+
+			_tx_returned.valid = false;
+			_rx_returned.valid = false;
+
+			/* discard interrupt sources of the dropped descriptors */
+			write<Int_source>(read<Int_source>());
+
+			_enable();
+		}
+
+		/**
+		 * Hand the TX descriptor at 'index' to the NIC
+		 *
+		 * \param last  frame is the last of a batch
+		 */
+		void _hand_over(unsigned const index, size_t const length, bool const last)
+		{
+			Tx_descriptor::access_t descr = _tx_shadow[index];
+			Tx_descriptor::Len::set(descr, length);
+			Tx_descriptor::Rd::set(descr, 1);
+
+			_tx_since_irq++;
+
+			bool const irq = last || _tx_since_irq >= _tx_irq_interval
+			              || _tx_pending + 1 == _geometry.tx;
+			if (irq) {
+				Tx_descriptor::Irq::set(descr, 1);
+				_tx_since_irq = 0;
+				_stats.tx_irqs++;
+			}
+
+			write<Tx_descriptor>(descr, index);
+
+			_tx_pending++;
+
+			_stats.tx_ring_high_water = max(_stats.tx_ring_high_water, _tx_pending);
+		}
+
+		/**
+		 * Return true if the NIC completed the oldest pending TX descriptor
+		 */
+		bool _tx_completed()
+		{
+			if (!_tx_pending)        return false;
+			if (_tx_returned.valid) return true;
+
+			Tx_descriptor::access_t const descr = read<Tx_descriptor>(_tx_done);
+			if (Tx_descriptor::Rd::get(descr)) return false;
+
+			_tx_returned = { .value = descr, .valid = true };
+			return true;
+		}
+
+		/**
+		 * Return true if the NIC filled the current RX descriptor
+		 */
+		bool _rx_completed()
+		{
+			if (_rx_returned.valid) return true;
+
+			Rx_descriptor::access_t const descr = read<Rx_descriptor>(_rx_slot(_rx_index()));
+			if (Rx_descriptor::E::get(descr)) return false;
+
+			_rx_returned = { .value = descr, .valid = true };
+			return true;
+		}
+
+
+		/**********************
+		 ** MII transactions **
+		 **********************/
+
+		void _phy_write_transaction()
+		{
+			wait_for(_delayer, Miistatus::Busy::Equal(0));
+			write<Miicommand::Wtrldata>(1);
+			wait_for(_delayer, Miistatus::Busy::Equal(0));
+			write<Miicommand::Wtrldata>(0);
+		}
+
+		void _phy_read_transaction()
+		{
+			wait_for(_delayer, Miistatus::Busy::Equal(0));
+			write<Miicommand::Rstat>(1);
+			wait_for(_delayer, Miistatus::Busy::Equal(0));
+			write<Miicommand::Rstat>(0);
+		}
+
+	public:
+
+		/**
+		 * Constructor
+		 *
+		 * \param range     register window of the device
+		 * \param dma       DMA memory, must hold 'geometry.dma_size()' bytes
+		 * \param geometry  ring geometry as returned by 'Geometry::sanitized'
+		 *
+		 * The PHY is not touched, see 'Phy'.
+		 */
+		Opencores(Byte_range_ptr const &range,
+		          Dma_window const     &dma,
+		          Net::Mac_address      mac,
+		          unsigned const        phy_port,
+		          Geometry const       &geometry,
+		          Filter const         &filter,
+		          Mmio::Delayer        &delayer)
+		:
+			Mmio(range),
+			_delayer(delayer), _mac(mac), _phy_port(phy_port),
+			_geometry(geometry), _dma(dma)
+		{
+			Moder::access_t moder = 0;
+			Moder::Bro::set(moder, 0);
+			Moder::Pro::set(moder, filter.promiscuous);
+			Moder::Ifg::set(moder, 1);
+			Moder::Exdfren::set(moder, 1);
+			Moder::Fulld::set(moder, 1);
+			Moder::NoPre::set(moder, 1);
+			Moder::Crcen::set(moder, 0);
+			write<Moder>(moder);
+
+			/* enable TX/RX interrupts */
+			irq_enabled(true);
+
+			/* set packet gaps to recommented values (eth_speci.pdf) */
+			write<Ipgt>(0x15);
+
+			write<Miiaddress::Fiad>(_phy_port);
+			_configure_mac_address();
+			configure_filter(filter);
+
+			unsigned const div = 10;
+			write<Miimoder::Clkdiv>(div);
+
+			/* number of TX descriptors */
+			write<Tx_bd::Num>(_geometry.tx);
+
+			/* fill tx/rx buffer descriptors, wrap bit set for last descriptors */
+			for (unsigned index = 0; index < _geometry.tx; index++)
+				_setup_transmit_buffer(index);
+
+			for (unsigned index = 0; index < _geometry.rx; index++)
+				_setup_receive_buffer(index);
+
+			log("rings: tx=", _geometry.tx, " rx=", _geometry.rx,
+			    " stride=", _geometry.stride);
+
+			_enable();
+		}
+
+		Net::Mac_address &mac_address() { return _mac; }
+
+
+		/********************
+		 ** Mdio interface **
+		 ********************/
+
+		uint16_t mdio_read(unsigned const reg) override
+		{
+			write<Miiaddress::Rgad>(reg);
+			_phy_read_transaction();
+			return (uint16_t)read<Miirx_data::Prsd>();
+		}
+
+		void mdio_write(unsigned const reg, uint16_t const value) override
+		{
+			write<Miiaddress::Rgad>(reg);
+			write<Miitx_data::Ctrldata>(value);
+			_phy_write_transaction();
+		}
+
+		void mdio_preamble(bool const enabled) override
+		{
+			write<Miimoder::Miinopre>(!enabled);
+		}
+
+		bool mdio_read_start(unsigned const reg) override
+		{
+			if (read<Miistatus::Busy>()) return false;
+
+			write<Miiaddress::Rgad>(reg);
+			write<Miicommand::Rstat>(1);
+			return true;
+		}
+
+		bool mdio_read_complete(uint16_t &value) override
+		{
+			if (read<Miistatus::Busy>()) return false;
+
+			write<Miicommand::Rstat>(0);
+			value = (uint16_t)read<Miirx_data::Prsd>();
+			return true;
+		}
+
+		/**
+		 * Adapt MAC to the duplex mode of the link
+		 *
+		 * Inter-packet gaps as recommended by the ethoc specification
+		 */
+		void configure_link(Phy::Link const &link)
+		{
+			if (!link.up) return;
+
+			write<Moder::Fulld>(link.full_duplex);
+			write<Ipgt>(link.full_duplex ? 0x15 : 0x12);
+		}
+
+		void configure_filter(Filter const &filter)
+		{
+			write<Hash>(filter.hash[0], 0);
+			write<Hash>(filter.hash[1], 1);
+			write<Moder::Pro>(filter.promiscuous);
+		}
+
+		void tx_irq_interval(unsigned const interval)
+		{
+			_tx_irq_interval = max(interval, 1u);
+		}
+
+		/*
+		 * As for reception, the client's packet cannot be transmitted in
+		 * place because the Uplink packet-stream buffer is not reachable by
+		 * the NIC. The frame is copied into the DMA slot of the descriptor,
+		 * which allows for acknowledging the packet to the client right away.
+		 *
+		 * The device polls the descriptors, so there is no doorbell register
+		 * to batch. Instead, if 'more' frames may follow, the descriptor is
+		 * staged and the completion interrupt is suppressed according to the
+		 * TX IRQ interval. The staged descriptor is handed to the NIC by the
+		 * next 'transmit', with an interrupt if that frame ends the batch, or
+		 * by 'flush_transmit'. Completed descriptors without interrupt are
+		 * reclaimed along with the next one that raises an interrupt.
+		 */
+		bool transmit(void const *address, size_t length, bool const more = false)
+		{
+			/* the descriptor at '_current_tx' is free unless the ring is full */
+			if (tx_ring_full()) return false;
+
+			void * const buffer = _transmit_buffer(_tx_index());
+
+			_copy_to_buffer(buffer, address, length);
+			_dma_clean(buffer, length);
+
+			/* make frame visible to the NIC before handing over the descriptor */
+			memory_barrier();
+
+			if (_tx_staged)
+				_hand_over(_tx_prev(), _tx_staged_len, false);
+
+			unsigned const index = _tx_index();
+			_current_tx = _tx_next();
+
+			/* the frame that fills the ring cannot be followed by more */
+			_tx_staged = more && _tx_pending + 1 < _geometry.tx;
+
+			if (_tx_staged) _tx_staged_len = length;
+			else            _hand_over(index, length, true);
+
+			return true;
+		}
+
+		/**
+		 * Hand a staged descriptor to the NIC as the last of its batch
+		 */
+		void flush_transmit()
+		{
+			if (!_tx_staged) return;
+
+			_tx_staged = false;
+			_hand_over(_tx_prev(), _tx_staged_len, true);
+		}
+
+		/**
+		 * Descriptor used by the next 'transmit'
+		 */
+		unsigned tx_slot() const { return _tx_index(); }
+
+		/**
+		 * Reclaim TX descriptors the NIC is done with, in ring order
+		 *
+		 * \param fn  called with the index of each reclaimed descriptor
+		 *
+		 * \return  number of reclaimed descriptors
+		 */
+		template <typename FN>
+		unsigned reclaim_transmitted(FN const &fn)
+		{
+			unsigned count = 0;
+
+			while (_tx_completed()) {
+				Tx_descriptor::account(_tx_returned.value, _stats);
+				fn(_tx_done);
+
+				_tx_returned.valid = false;
+				_tx_done = _tx_done_next();
+				_tx_pending--;
+				count++;
+			}
+
+			return count;
+		}
+
+		/**
+		 * Reset the descriptor rings, e.g., after the NIC stalled on TX
+		 *
+		 * The MAC is soft reset, which returns its descriptor pointers to
+		 * the start of the rings, and its configuration is restored. All
+		 * descriptors and their shadows are set up anew, and the MAC is
+		 * started again. Frames pending for transmission and frames not yet
+		 * harvested are dropped. The PHY is left untouched.
+		 */
+		void reset_rings()
+		{
+			_stats.tx_resets++;
+			_reset_rings();
+		}
+
+		/**
+		 * Change the ring geometry at runtime, like 'reset_rings'
+		 *
+		 * \param geometry  ring geometry as returned by 'Geometry::sanitized'
+		 *
+		 * \return  false if the rings would not fit into the DMA window
+		 */
+		bool resize_rings(Geometry const &geometry)
+		{
+			if (geometry.dma_size() > _dma.size)
+				return false;
+
+			_geometry = geometry;
+			_reset_rings();
+
+			log("rings: tx=", _geometry.tx, " rx=", _geometry.rx,
+			    " stride=", _geometry.stride);
+			return true;
+		}
+
+		Geometry const &geometry() const { return _geometry; }
+
+		void configure_mac_address(Net::Mac_address const &mac)
+		{
+			_mac = mac;
+			_configure_mac_address();
+		}
+
+		unsigned reclaim_transmitted() {
+			return reclaim_transmitted([] (unsigned) { }); }
+
+		unsigned tx_ring_used() const { return _tx_pending + _tx_staged; }
+		bool     tx_ring_full() const { return tx_ring_used() == _geometry.tx; }
+
+		Statistics const &statistics() const { return _stats; }
+
+		/**
+		 * Record number of frames harvested in one pass
+		 */
+		void rx_harvested(unsigned const count)
+		{
+			_stats.rx_ring_high_water = max(_stats.rx_ring_high_water, count);
+		}
+
+		/*
+		 * Zero-copy reception is not possible: the Uplink packet-stream
+		 * buffers are allocated by the session's server and are not
+		 * addressable by the NIC (on MiG-V, DMA is restricted to the SRAM
+		 * window). Instead, the DMA slot of the next filled descriptor is
+		 * handed to 'fn' such that the frame is copied exactly once, directly
+		 * into the packet-stream buffer. The descriptor is read only once and
+		 * returned to the NIC by writing its shadow after 'fn' is done,
+		 * regardless of whether the frame could be forwarded.
+		 *
+		 * \return  false if no frame was pending
+		 */
+		template <typename FN>
+		bool with_received_frame(FN const &fn)
+		{
+			if (!_rx_completed()) return false;
+
+			Rx_descriptor::access_t const descr = _rx_returned.value;
+
+			void const * const buffer = _receive_buffer(_rx_index());
+			size_t       const length = Rx_descriptor::Len::get(descr);
+
+			Rx_descriptor::account(descr, _stats);
+
+			_dma_invalidate(buffer, length);
+			fn(buffer, length);
+
+			write<Rx_descriptor>(_rx_shadow[_rx_index()], _rx_slot(_rx_index()));
+			_rx_returned.valid = false;
+			_current_rx = _rx_next();
+
+			return true;
+		}
+
+		/**
+		 * Copy a frame handed out by 'with_received_frame' to 'dst'
+		 */
+		void copy_received(void *dst, void const *frame, size_t length) const
+		{
+			if (_dma.cached) memcpy(dst, frame, length);
+			else             Dma_copy::from_device(dst, frame, length);
+		}
+
+		/**
+		 * Enable or disable TX/RX interrupts at the device
+		 *
+		 * Pending interrupt sources are cleared before enabling interrupts,
+		 * callers must harvest the rings afterwards to catch frames that
+		 * arrived in between.
+		 */
+		void irq_enabled(bool const enabled)
+		{
+			Int_mask::access_t mask = 0;
+
+			if (enabled) {
+				write<Int_source>(read<Int_source>());
+
+				Int_mask::Txb::set(mask, 1);
+				Int_mask::Txe::set(mask, 1);
+				Int_mask::Rxb::set(mask, 1);
+			}
+
+			write<Int_mask>(mask);
+		}
+
+		/**
+		 * Account frames dropped for lack of an empty RX descriptor
+		 *
+		 * While polling, the interrupt sources are not processed by
+		 * 'with_irq', which otherwise accounts the busy condition.
+		 */
+		void update_rx_busy()
+		{
+			if (!read<Int_source::Busy>()) return;
+
+			_stats.rx_busy++;
+			write<Int_source>(Int_source::Busy::bits(1));
+		}
+
+		template <typename TX_FN, typename RX_FN>
+		void with_irq(TX_FN const tx_fn, RX_FN const rx_fn)
+		{
+			Int_source::access_t source = read<Int_source>();
+
+			if (Int_source::Busy::get(source))
+				_stats.rx_busy++;
+
+			if (Int_source::Rxb::get(source))
+				rx_fn();
+
+			if (Int_source::Txb::get(source) || Int_source::Txe::get(source))
+				tx_fn();
+
+			write<Int_source>(source);
+		}
+};
+
+#endif /* _SRC__DRIVER__NIC__OPENCORES__OPENCORES_H_ */
@@ -0,0 +1,239 @@
+/*
+ * \brief  MII PHY handling of the OpenCores Ethernet driver
+ * \author agent
+ * \date   2026-10-16
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#ifndef _SRC__DRIVER__NIC__OPENCORES__PHY_H_
+#define _SRC__DRIVER__NIC__OPENCORES__PHY_H_
+
+#include <base/exception.h>
+#include <base/log.h>
+#include <util/interface.h>
+
+namespace Genode {
+	struct Mdio;
+	class  Phy;
+}
+
+
+/*
+ * Access to the registers of the PHY via the management interface
+ */
+struct Genode::Mdio : Interface
+{
+	virtual uint16_t mdio_read(unsigned reg) = 0;
+
+	virtual void mdio_write(unsigned reg, uint16_t value) = 0;
+
+	/**
+	 * Enable or disable the preamble of management frames
+	 */
+	virtual void mdio_preamble(bool enabled) = 0;
+
+	/**
+	 * Start reading 'reg' without waiting for the management interface
+	 *
+	 * \return  false if the interface is busy
+	 */
+	virtual bool mdio_read_start(unsigned reg) = 0;
+
+	/**
+	 * Complete the read started by 'mdio_read_start' without waiting
+	 *
+	 * \return  false if the read is still in progress
+	 */
+	virtual bool mdio_read_complete(uint16_t &value) = 0;
+};
+
+
+class Genode::Phy
+{
+	public:
+
+		struct Reset_failed : Exception { };
+
+		struct Link
+		{
+			bool     up;
+			unsigned speed;       /* Mbit/s */
+			bool     full_duplex;
+
+			bool operator != (Link const &other) const
+			{
+				return up != other.up || speed != other.speed
+				    || full_duplex != other.full_duplex;
+			}
+
+			void print(Output &out) const
+			{
+				if (!up) { Genode::print(out, "down"); return; }
+				Genode::print(out, "up, ", speed, " Mbit/s ",
+				              full_duplex ? "full" : "half", " duplex");
+			}
+		};
+
+		enum Register {
+			BMCR   = 0x0,  /* basic mode control            */
+			BMSR   = 0x1,  /* basic mode status             */
+			ANAR   = 0x4,  /* auto-negotiation advertisement */
+			ANLPAR = 0x5,  /* auto-negotiation link partner  */
+			MICR   = 0x11  /* MII IRQ control               */
+		};
+
+		enum : uint16_t {
+			BMCR_DUPLEX_MODE      = 0x100,
+			BMCR_RESTART_AN       = 0x200,
+			BMCR_AN_ENABLE        = 0x1000,
+			BMCR_SPEED_SELECTION  = 0x2000,
+			BMCR_RESET            = 0x8000,
+			BMSR_LINK_STATUS      = 0x4,
+			BMSR_AN_COMPLETE      = 0x20,
+
+			/* technology abilities of ANAR and ANLPAR */
+			AN_CSMA               = 0x1,
+			AN_10_HALF            = 0x20,
+			AN_10_FULL            = 0x40,
+			AN_100_HALF           = 0x80,
+			AN_100_FULL           = 0x100,
+		};
+
+	private:
+
+		Mdio      &_mdio;
+		bool const _autoneg;
+
+		/* read of BMSR started by 'link_changed' */
+		bool _bmsr_pending { false };
+
+		void _reset()
+		{
+			_mdio.mdio_write(BMCR, BMCR_RESET);
+
+			/* the first read after the reset requires a preamble */
+			_mdio.mdio_preamble(true);
+			uint16_t bmcr = _mdio.mdio_read(BMCR);
+			_mdio.mdio_preamble(false);
+
+			unsigned retry = 0;
+			while (bmcr & BMCR_RESET && retry++ < 20)
+				bmcr = _mdio.mdio_read(BMCR);
+
+			if (retry >= 20) {
+				Genode::error("PHY reset failed");
+				throw Reset_failed();
+			}
+		}
+
+		/*
+		 * Configure the PHY without waiting for the link, which is
+		 * monitored via 'link_state'
+		 */
+		void _init()
+		{
+			/* assert interrupt output enable */
+			_mdio.mdio_write(MICR, _mdio.mdio_read(MICR) | 0x1);
+
+			if (_autoneg) {
+				/* advertise all abilities of the MAC and (re)start negotiation */
+				_mdio.mdio_write(ANAR, AN_CSMA | AN_10_HALF | AN_10_FULL |
+				                       AN_100_HALF | AN_100_FULL);
+				_mdio.mdio_write(BMCR, BMCR_AN_ENABLE | BMCR_RESTART_AN);
+				return;
+			}
+
+			/* full duplex, no auto negotiation, 100 MBit/s */
+			_mdio.mdio_write(BMCR, BMCR_DUPLEX_MODE | BMCR_SPEED_SELECTION);
+		}
+
+	public:
+
+		/**
+		 * Constructor, resets and configures the PHY
+		 *
+		 * \throw Reset_failed
+		 */
+		Phy(Mdio &mdio, bool const autoneg)
+		:
+			_mdio(mdio), _autoneg(autoneg)
+		{
+			_reset();
+			_init();
+		}
+
+		/**
+		 * Return link state as reported by the PHY, which blocks for the
+		 * management transactions
+		 *
+		 * The link-status bit is latched low, so a link loss is reported at
+		 * least once even if the link came back in the meantime. With
+		 * auto-negotiation, the link is considered up not before the
+		 * negotiation completed, speed and duplex mode are resolved from the
+		 * abilities common to both link partners.
+		 */
+		Link link_state()
+		{
+			/* the blocking reads below supersede a pending read */
+			_bmsr_pending = false;
+
+			uint16_t const bmsr = _mdio.mdio_read(BMSR);
+
+			if (!(bmsr & BMSR_LINK_STATUS))
+				return { .up = false, .speed = 0, .full_duplex = false };
+
+			if (!_autoneg) {
+				uint16_t const bmcr = _mdio.mdio_read(BMCR);
+				return { .up          = true,
+				         .speed       = (bmcr & BMCR_SPEED_SELECTION) ? 100u : 10u,
+				         .full_duplex = (bmcr & BMCR_DUPLEX_MODE) != 0 };
+			}
+
+			if (!(bmsr & BMSR_AN_COMPLETE))
+				return { .up = false, .speed = 0, .full_duplex = false };
+
+			uint16_t const common = _mdio.mdio_read(ANAR) & _mdio.mdio_read(ANLPAR);
+
+			if (common & AN_100_FULL) return { true, 100, true  };
+			if (common & AN_100_HALF) return { true, 100, false };
+			if (common & AN_10_FULL)  return { true, 10,  true  };
+
+			return { true, 10, false };
+		}
+
+		/**
+		 * Check for a change of the link without waiting for the PHY
+		 *
+		 * Each call collects the BMSR value read since the previous call and
+		 * starts the next read, so the caller never blocks on a management
+		 * transaction. Only if the link may have changed compared to 'link',
+		 * the caller needs to determine the new state via 'link_state'.
+		 */
+		bool link_changed(Link const &link)
+		{
+			uint16_t bmsr  = 0;
+			bool     valid = _bmsr_pending && _mdio.mdio_read_complete(bmsr);
+
+			/* a read still in progress is collected by the next call */
+			if (_bmsr_pending && !valid)
+				return false;
+
+			_bmsr_pending = _mdio.mdio_read_start(BMSR);
+
+			if (!valid)
+				return false;
+
+			bool const up = (bmsr & BMSR_LINK_STATUS)
+			             && (!_autoneg || (bmsr & BMSR_AN_COMPLETE));
+
+			return up != link.up;
+		}
+};
+
+#endif /* _SRC__DRIVER__NIC__OPENCORES__PHY_H_ */
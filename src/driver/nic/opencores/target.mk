@@ -2,6 +2,8 @@ TARGET = opencores_nic
 SRC_CC = main.cc
 LIBS   = base nic_driver
 
+INC_DIR += $(PRG_DIR)
+
 vpath %.cc $(PRG_DIR)
 
 
@@ -33,6 +33,14 @@ namespace Hw::Riscv_board {
 
 	static constexpr Genode::size_t NR_OF_CPUS = 1;
 
+	/*
+	 * PLIC priority of an interrupt source (1 to 15), of several pending
+	 * sources the one with the highest priority is claimed first. The
+	 * Ethernet MAC (IRQ 22) takes precedence over the other devices.
+	 */
+	static constexpr unsigned irq_priority(unsigned irq) {
+		return irq == 22 ? 2 : 1; }
+
 	enum { UART_BASE, UART_CLOCK };
 	struct Serial : Hw::Riscv_uart {
 		Serial(Genode::addr_t, Genode::size_t, unsigned) {} };
@@ -27,12 +27,32 @@ namespace Hw::Riscv_board {
 		RAM_SIZE = 0x1ffa0000,
 		TIMER_HZ = 10000000,
 
-		PLIC_BASE = 0xc000000,
-		PLIC_SIZE = 0x202000,
+		/*
+		 * The PLIC mapping covers the machine- and supervisor-mode contexts
+		 * of up to PLIC_HARTS harts (VIRT_CPUS_MAX of Qemu prior to 7.0)
+		 */
+		PLIC_HARTS = 8,
+		PLIC_BASE  = 0xc000000,
+		PLIC_SIZE  = 0x200000 + 2 * PLIC_HARTS * 0x1000,
 	};
 
+	/*
+	 * Secondary harts of a '-smp' machine remain stopped within the SBI
+	 * because bootstrap and kernel of base-hw do not start them on RISC-V.
+	 */
 	static constexpr Genode::size_t NR_OF_CPUS = 1;
 
+	static_assert(NR_OF_CPUS <= PLIC_HARTS, "PLIC contexts missing for harts");
+
+	/*
+	 * PLIC priority of an interrupt source (1 to 7), of several pending
+	 * sources the one with the highest priority is claimed first. Sources
+	 * with a priority not above PLIC_THRESHOLD are masked at all harts.
+	 */
+	static constexpr unsigned irq_priority(unsigned) { return 1; }
+
+	enum { PLIC_THRESHOLD = 0 };
+
 	enum { UART_BASE, UART_CLOCK };
 
 	struct Serial : Hw::Riscv_uart
@@ -0,0 +1,191 @@
+/*
+ * \brief  Per-packet copy cost for cached and uncached DMA buffers
+ * \author agent
+ * \date   2026-10-16
+ *
+ * Copies frames of different sizes into (TX) and out of (RX) DMA buffers
+ * the same way as the OpenCores NIC driver does. The uncached buffers are
+ * the DMA window of the OpenCores device, i.e., its second I/O memory
+ * resource such as the SRAM of MiG-V, where the word-wise copy routines of
+ * the driver are compared to plain 'memcpy'. The cached buffers are RAM,
+ * either without maintenance as for a coherent device, or with Zicbom cache
+ * maintenance around each hand-off. RAM dataspaces requested as uncached
+ * are not measured because the page tables of base-hw on RISC-V carry no
+ * cacheability attributes.
+ *
+ * If the CPU clock is configured via 'cpu_mhz', the cost is additionally
+ * reported in cycles per byte.
+ *
+ * Cache-block operations from user level require the kernel to enable them
+ * via 'senvcfg', therefore the Zicbom variant must be enabled explicitly by
+ * '<config zicbom="yes"/>' and is refused unless 'Zicbom::USER_LEVEL' is set.
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#include <base/attached_ram_dataspace.h>
+#include <base/attached_rom_dataspace.h>
+#include <base/component.h>
+#include <base/log.h>
+#include <platform_session/device.h>
+#include <timer_session/connection.h>
+
+/* local includes */
+#include <cache.h>
+#include <dma_copy.h>
+
+using namespace Genode;
+
+
+class Main
+{
+	private:
+
+		enum {
+			STRIDE      = 2048,
+			BUFFERS     = 64,
+			BUFFER_SIZE = BUFFERS * STRIDE,
+			ROUNDS      = 20000,
+		};
+
+		Env &_env;
+
+		Attached_rom_dataspace _config { _env, "config" };
+		Timer::Connection      _timer  { _env };
+
+		bool   const _zicbom     { _config.node().attribute_value("zicbom", false) };
+		size_t const _block_size { _config.node().attribute_value("cache_block_size", 64ul) };
+		unsigned const _cpu_mhz  { _config.node().attribute_value("cpu_mhz", 0u) };
+
+		Platform::Connection       _platform   { _env };
+		Platform::Device           _device     { _platform };
+		Platform::Device::Mmio<0>  _dma_window { _device, Platform::Device::Mmio<0>::Index { 1 } };
+
+		Attached_ram_dataspace _packets { _env.ram(), _env.rm(), BUFFER_SIZE };
+		Attached_ram_dataspace _cached  { _env.ram(), _env.rm(), BUFFER_SIZE, CACHED };
+
+		enum class Maintenance { NONE, ZICBOM };
+		enum class Copy        { MEMCPY, WORDS };
+
+		uint64_t _now_us() { return _timer.curr_time().trunc_to_plain_us().value; }
+
+		/**
+		 * Call 'fn' for 'ROUNDS' buffer offsets
+		 *
+		 * \return  nanoseconds per call
+		 */
+		template <typename FN>
+		uint64_t _measure_ns(FN const &fn)
+		{
+			uint64_t const start = _now_us();
+
+			for (unsigned i = 0; i < ROUNDS; i++)
+				fn((i % BUFFERS) * STRIDE);
+
+			return (_now_us() - start) * 1000 / ROUNDS;
+		}
+
+		/**
+		 * Cycles per byte in hundredths
+		 */
+		uint64_t _cpb(uint64_t const ns, size_t const size) const {
+			return ns * _cpu_mhz / 10 / size; }
+
+		struct Cpb
+		{
+			uint64_t value;
+
+			void print(Output &out) const
+			{
+				Genode::print(out, value / 100, ".", value % 100 < 10 ? "0" : "",
+				              value % 100);
+			}
+		};
+
+		void _bench(char const *mode, char *dma, size_t const size,
+		            Maintenance const maintenance, Copy const copy)
+		{
+			char * const packets = _packets.local_addr<char>();
+			bool   const cbo     = maintenance == Maintenance::ZICBOM;
+			bool   const words   = copy == Copy::WORDS;
+
+			uint64_t const tx_ns = _measure_ns([&] (size_t offset) {
+				if (words) Dma_copy::to_device(dma + offset, packets + offset, size);
+				else       memcpy(dma + offset, packets + offset, size);
+				if (cbo) Zicbom::clean(dma + offset, size, _block_size);
+			});
+
+			uint64_t const rx_ns = _measure_ns([&] (size_t offset) {
+				if (cbo) Zicbom::invalidate(dma + offset, size, _block_size);
+				if (words) Dma_copy::from_device(packets + offset, dma + offset, size);
+				else       memcpy(packets + offset, dma + offset, size);
+			});
+
+			if (!_cpu_mhz) {
+				log("<result mode=\"", mode, "\" size=\"", size, "\""
+				    " tx_ns=\"", tx_ns, "\" rx_ns=\"", rx_ns, "\"/>");
+				return;
+			}
+
+			log("<result mode=\"", mode, "\" size=\"", size, "\""
+			    " tx_ns=\"", tx_ns, "\" rx_ns=\"", rx_ns, "\""
+			    " tx_cpb=\"", Cpb { _cpb(tx_ns, size) }, "\""
+			    " rx_cpb=\"", Cpb { _cpb(rx_ns, size) }, "\"/>");
+		}
+
+	public:
+
+		Main(Env &env) : _env(env)
+		{
+			bool zicbom = _zicbom;
+
+			if (zicbom && !Zicbom::USER_LEVEL) {
+				warning("cache-block operations are not permitted by the kernel, "
+				        "skipping the Zicbom variant");
+				zicbom = false;
+			}
+
+			if (zicbom && !Zicbom::valid_block_size(_block_size)) {
+				warning("invalid cache block size ", _block_size,
+				        ", skipping the Zicbom variant");
+				zicbom = false;
+			}
+
+			if (_dma_window.range().num_bytes < BUFFER_SIZE) {
+				error("DMA window smaller than ", (size_t)BUFFER_SIZE, " bytes");
+				return;
+			}
+
+			char * const window = _dma_window.local_addr<char>();
+
+			size_t const sizes[] = { 64, 256, 512, 1024, 1514 };
+
+			for (size_t const size : sizes) {
+				_bench("dma_window", window, size,
+				       Maintenance::NONE, Copy::MEMCPY);
+				_bench("dma_window_words", window, size,
+				       Maintenance::NONE, Copy::WORDS);
+				_bench("coherent", _cached.local_addr<char>(), size,
+				       Maintenance::NONE, Copy::MEMCPY);
+
+				if (zicbom)
+					_bench("cached_zicbom", _cached.local_addr<char>(), size,
+					       Maintenance::ZICBOM, Copy::MEMCPY);
+			}
+
+			log("--- DMA benchmark finished ---");
+		}
+};
+
+
+void Component::construct(Genode::Env &env)
+{
+	log("--- DMA benchmark --");
+
+	static Main main(env);
+}
@@ -0,0 +1,7 @@
+TARGET = test-dma_bench
+SRC_CC = main.cc
+LIBS   = base
+
+INC_DIR += $(REP_DIR)/src/driver/nic/opencores
+
+vpath %.cc $(PRG_DIR)
@@ -0,0 +1,412 @@
+/*
+ * \brief  Latency from a device interrupt to the Genode signal handler
+ * \author agent
+ * \date   2026-10-16
+ *
+ * A one-shot event of a device is programmed at a deadline, and the signal
+ * handler of the interrupt compares the device clock at its entry with the
+ * deadline. Event sources are Timer0 on MIG-V and the Goldfish RTC of the
+ * Qemu virt machine. Both count in their own clock domain, which avoids any
+ * calibration against the CPU clock.
+ *
+ * The benchmark runs three phases:
+ *
+ * 1. Latency with an idle system
+ * 2. Latency while a thread of the same priority spins
+ * 3. Interrupt rate with the spinning thread, where each handler re-arms
+ *    the event for the earliest possible deadline
+ *
+ * The Goldfish RTC fires immediately for a deadline in the past, so the
+ * rate of phase 3 is the interrupt-handling throughput. Timer0 needs a
+ * deadline at least two counter ticks (about 61 us) ahead, which bounds
+ * the rate at about 16k IRQs/s. This phase then reports the re-arm rate
+ * of the timer rather than the throughput of interrupt handling.
+ *
+ * Configuration:
+ *
+ * ! <config source="timer0" samples="1000" interval_us="1000" duration_ms="1000"/>
+ *
+ * The 'source' attribute selects "timer0" (MIG-V) or "goldfish_rtc" (Qemu).
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#include <base/attached_rom_dataspace.h>
+#include <base/component.h>
+#include <base/log.h>
+#include <base/thread.h>
+#include <irq_session/connection.h>
+#include <os/attached_mmio.h>
+#include <util/reconstructible.h>
+
+using namespace Genode;
+
+namespace Genode {
+
+	struct Event_source;
+	class  Timer0;
+	class  Goldfish_rtc;
+}
+
+
+/*
+ * Device that raises an interrupt at a programmable deadline
+ */
+struct Genode::Event_source : Interface
+{
+	virtual char const *name() const = 0;
+
+	virtual unsigned irq() const = 0;
+
+	/**
+	 * Current time of the device clock in nanoseconds
+	 */
+	virtual uint64_t now_ns() = 0;
+
+	/**
+	 * Program the event, which clears a pending event before
+	 *
+	 * \return  deadline in nanoseconds after rounding to the device clock
+	 */
+	virtual uint64_t arm(uint64_t deadline_ns) = 0;
+
+	/**
+	 * Earliest deadline relative to now that is guaranteed to trigger
+	 */
+	virtual uint64_t min_delta_ns() const = 0;
+
+	virtual void stop() = 0;
+};
+
+
+/*
+ * Timer0 of MIG-V, a 32-bit counter at 32 kHz with compare register
+ *
+ * The resolution of a sample is the counter period of about 30.5 us.
+ */
+class Genode::Timer0 : Attached_mmio<0xc>, public Event_source
+{
+	private:
+
+		enum { BASE = 0x409000, IRQ = 16, HZ = 32 * 1024 };
+
+		struct Timer : Register<0x0, 32> { };
+		struct Ctrl  : Register<0x4, 32>
+		{
+			struct Enable : Bitfield<0, 1> { };
+		};
+		struct Cmp   : Register<0x8, 32> { };
+
+		uint64_t _high { 0 };
+		uint32_t _last { 0 };
+
+		/* extend the counter to 64 bit */
+		uint64_t _ticks()
+		{
+			uint32_t const ticks = read<Timer>();
+
+			if (ticks < _last) _high += 1ull << 32;
+			_last = ticks;
+
+			return _high | ticks;
+		}
+
+		static uint64_t _ns(uint64_t ticks) { return ticks * 1000 * 1000 * 1000 / HZ; }
+
+	public:
+
+		Timer0(Env &env)
+		:
+			Attached_mmio(env, {(char *)BASE, 0x1000})
+		{
+			write<Ctrl::Enable>(1);
+		}
+
+		char const *name() const override { return "timer0"; }
+		unsigned    irq()  const override { return IRQ; }
+
+		uint64_t now_ns() override { return _ns(_ticks()); }
+
+		uint64_t arm(uint64_t const deadline_ns) override
+		{
+			/* round up to the next counter tick */
+			uint64_t const ticks = (deadline_ns * HZ + 999999999) / (1000 * 1000 * 1000);
+
+			write<Cmp>((uint32_t)ticks);
+			return _ns(ticks);
+		}
+
+		uint64_t min_delta_ns() const override { return 2 * _ns(1); }
+
+		void stop() override { write<Ctrl::Enable>(0); }
+};
+
+
+/*
+ * Goldfish RTC of the Qemu virt machine, a nanosecond clock with alarm
+ */
+class Genode::Goldfish_rtc : Attached_mmio<0x20>, public Event_source
+{
+	private:
+
+		enum { BASE = 0x101000, IRQ = 11 };
+
+		/* reading 'Time_low' latches 'Time_high' */
+		struct Time_low        : Register<0x00, 32> { };
+		struct Time_high       : Register<0x04, 32> { };
+		struct Alarm_low       : Register<0x08, 32> { };
+		struct Alarm_high      : Register<0x0c, 32> { };
+		struct Irq_enabled     : Register<0x10, 32> { };
+		struct Clear_alarm     : Register<0x14, 32> { };
+		struct Alarm_status    : Register<0x18, 32> { };
+		struct Clear_interrupt : Register<0x1c, 32> { };
+
+	public:
+
+		Goldfish_rtc(Env &env)
+		:
+			Attached_mmio(env, {(char *)BASE, 0x1000})
+		{
+			write<Irq_enabled>(1);
+		}
+
+		char const *name() const override { return "goldfish_rtc"; }
+		unsigned    irq()  const override { return IRQ; }
+
+		uint64_t now_ns() override
+		{
+			uint32_t const low = read<Time_low>();
+			return ((uint64_t)read<Time_high>() << 32) | low;
+		}
+
+		uint64_t arm(uint64_t const deadline_ns) override
+		{
+			write<Clear_interrupt>(1);
+
+			/* writing 'Alarm_low' programs the alarm */
+			write<Alarm_high>((uint32_t)(deadline_ns >> 32));
+			write<Alarm_low>((uint32_t)deadline_ns);
+			return deadline_ns;
+		}
+
+		/* an alarm in the past fires immediately */
+		uint64_t min_delta_ns() const override { return 0; }
+
+		void stop() override
+		{
+			write<Clear_alarm>(1);
+			write<Irq_enabled>(0);
+			write<Clear_interrupt>(1);
+		}
+};
+
+
+class Main
+{
+	private:
+
+		enum { MAX_SAMPLES = 10000 };
+
+		enum class Phase { IDLE, LOADED, THROUGHPUT, DONE };
+
+		/*
+		 * Thread competing with the entrypoint for the CPU
+		 */
+		struct Load : Thread
+		{
+			bool volatile     _stop       { false };
+			uint64_t volatile iterations  { 0 };
+
+			Load(Env &env) : Thread(env, "load", 8 * 1024) { start(); }
+
+			~Load()
+			{
+				_stop = true;
+				join();
+			}
+
+			void entry() override
+			{
+				while (!_stop)
+					iterations = iterations + 1;
+			}
+		};
+
+		Env &_env;
+
+		Attached_rom_dataspace _config { _env, "config" };
+
+		using Source_name = String<16>;
+
+		Source_name const _source_name {
+			_config.node().attribute_value("source", Source_name("timer0")) };
+
+		unsigned const _samples {
+			min(max(_config.node().attribute_value("samples", 1000u), 1u),
+			    (unsigned)MAX_SAMPLES) };
+
+		uint64_t const _interval_ns {
+			_config.node().attribute_value("interval_us", (uint64_t)1000) * 1000 };
+
+		uint64_t const _duration_ns {
+			_config.node().attribute_value("duration_ms", (uint64_t)1000) * 1000 * 1000 };
+
+		Constructible<Timer0>       _timer0       { };
+		Constructible<Goldfish_rtc> _goldfish_rtc { };
+
+		Event_source &_init_source()
+		{
+			if (_source_name == "goldfish_rtc") {
+				_goldfish_rtc.construct(_env);
+				return *_goldfish_rtc;
+			}
+
+			if (_source_name != "timer0")
+				warning("unknown source '", _source_name, "', using timer0");
+
+			_timer0.construct(_env);
+			return *_timer0;
+		}
+
+		Event_source &_source { _init_source() };
+
+		Irq_connection       _irq         { _env, _source.irq() };
+		Signal_handler<Main> _irq_handler { _env.ep(), *this, &Main::_handle_irq };
+
+		Constructible<Load> _load { };
+
+		Phase    _phase    { Phase::IDLE };
+		uint64_t _deadline { 0 };
+		unsigned _count    { 0 };
+		unsigned _early    { 0 };
+		uint64_t _start    { 0 };
+
+		uint64_t _latency[MAX_SAMPLES] { };
+
+		static void _sort(uint64_t *values, unsigned const count)
+		{
+			/* shell sort with Ciura's gap sequence */
+			static unsigned const gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+
+			for (unsigned gap : gaps)
+				for (unsigned i = gap; i < count; i++) {
+					uint64_t const value = values[i];
+
+					unsigned j = i;
+					for (; j >= gap && values[j - gap] > value; j -= gap)
+						values[j] = values[j - gap];
+
+					values[j] = value;
+				}
+		}
+
+		void _report_latency(char const *phase)
+		{
+			_sort(_latency, _count);
+
+			auto percentile = [&] (unsigned p) {
+				return _latency[(uint64_t)(_count - 1) * p / 100]; };
+
+			log(_source.name(), " latency ", phase, ": samples=", _count,
+			    " min=",    _latency[0],         "ns",
+			    " median=", percentile(50),      "ns",
+			    " p99=",    percentile(99),      "ns",
+			    " max=",    _latency[_count - 1], "ns");
+
+			if (_early)
+				warning(_early, " interrupts arrived before their deadline");
+		}
+
+		void _arm(uint64_t const deadline_ns) {
+			_deadline = _source.arm(deadline_ns); }
+
+		void _handle_irq()
+		{
+			uint64_t const now = _source.now_ns();
+
+			switch (_phase) {
+
+			case Phase::IDLE:
+			case Phase::LOADED:
+
+				if (now >= _deadline)
+					_latency[_count++] = now - _deadline;
+				else
+					_early++;
+
+				if (_count < _samples) {
+					_arm(now + _interval_ns);
+					break;
+				}
+
+				if (_phase == Phase::IDLE) {
+					_report_latency("idle");
+					_load.construct(_env);
+					_phase = Phase::LOADED;
+				} else {
+					_report_latency("loaded");
+					_phase = Phase::THROUGHPUT;
+					_start = now;
+				}
+
+				_count = 0;
+				_early = 0;
+				_arm(now + (_phase == Phase::LOADED ? _interval_ns
+				                                     : _source.min_delta_ns()));
+				break;
+
+			case Phase::THROUGHPUT:
+
+				_count++;
+
+				if (now - _start < _duration_ns) {
+					_arm(now + _source.min_delta_ns());
+					break;
+				}
+
+				log(_source.name(), _source.min_delta_ns() ? " re-arm rate" : " throughput",
+				    " loaded: ", _count, " IRQs in ",
+				    (now - _start) / 1000, "us, ",
+				    (uint64_t)_count * 1000 * 1000 * 1000 / (now - _start), " IRQs/s, ",
+				    "load iterations=", _load->iterations);
+
+				_load.destruct();
+				_source.stop();
+				_phase = Phase::DONE;
+
+				log("Benchmark finished");
+				return;
+
+			case Phase::DONE:
+				return;
+			}
+
+			_irq.ack_irq();
+		}
+
+	public:
+
+		Main(Env &env) : _env(env)
+		{
+			_irq.sigh(_irq_handler);
+
+			log(_source.name(), ": ", _samples, " samples, interval ",
+			    _interval_ns / 1000, "us");
+
+			_arm(_source.now_ns() + _interval_ns);
+			_irq.ack_irq();
+		}
+};
+
+
+void Component::construct(Genode::Env &env)
+{
+	log("--- IRQ latency benchmark ---");
+
+	static Main main(env);
+}
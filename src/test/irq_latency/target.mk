@@ -0,0 +1,5 @@
+TARGET = test-irq_latency
+SRC_CC = main.cc
+LIBS   = base
+
+vpath %.cc $(PRG_DIR)
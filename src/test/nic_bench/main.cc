@@ -0,0 +1,392 @@
+/*
+ * \brief  NIC throughput and round-trip latency benchmark
+ * \author agent
+ * \date   2026-10-16
+ *
+ * The benchmark sends ICMP echo requests via a NIC session to a target
+ * (the QEMU user-networking gateway by default) for a range of frame sizes.
+ * For each size, it first measures round-trip times with a single request
+ * in flight, and then the echo rate with a window of requests in flight.
+ * A request without reply within 'timeout_ms' is accounted as lost.
+ *
+ * Results are logged as one '<result .../>' line per frame size.
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#include <base/attached_rom_dataspace.h>
+#include <base/component.h>
+#include <base/heap.h>
+#include <base/log.h>
+#include <net/arp.h>
+#include <net/ethernet.h>
+#include <net/icmp.h>
+#include <net/ipv4.h>
+#include <net/size_guard.h>
+#include <nic/packet_allocator.h>
+#include <nic_session/connection.h>
+#include <timer_session/connection.h>
+
+using namespace Genode;
+using namespace Net;
+
+namespace Test { struct Main; }
+
+
+struct Test::Main
+{
+	enum {
+		ICMP_ID          = 0x4e42,
+		HEADER_SIZE      = sizeof(Ethernet_frame) + sizeof(Ipv4_packet)
+		                 + sizeof(Icmp_packet),
+		LATENCY_SAMPLES  = 200,
+		MAX_REQUESTS     = 4000,
+		BUF_SIZE         = Nic::Packet_allocator::DEFAULT_PACKET_SIZE * 128,
+	};
+
+	enum class Phase { ARP, LATENCY, THROUGHPUT, DONE };
+
+	Env &_env;
+
+	Attached_rom_dataspace _config { _env, "config" };
+	Timer::Connection      _timer  { _env };
+	Heap                   _heap   { _env.ram(), _env.rm() };
+
+	Nic::Packet_allocator _pkt_alloc { &_heap };
+	Nic::Connection       _nic       { _env, &_pkt_alloc, BUF_SIZE, BUF_SIZE };
+
+	Mac_address const  _mac     { _nic.mac_address() };
+	Mac_address        _gw_mac  { };
+	Ipv4_address const _ip      { _config.node().attribute_value("ip",      Ipv4_address()) };
+	Ipv4_address const _gateway { _config.node().attribute_value("gateway", Ipv4_address()) };
+	Ipv4_address const _target  { _config.node().attribute_value("target",  Ipv4_address()) };
+
+	unsigned const _requests  { min(_config.node().attribute_value("requests", 2000u),
+	                                (unsigned)MAX_REQUESTS) };
+	unsigned const _window    { max(_config.node().attribute_value("window", 32u), 1u) };
+	uint64_t const _timeout_us { _config.node().attribute_value("timeout_ms", 500ul) * 1000 };
+
+	size_t const _sizes[6] { 64, 128, 256, 512, 1024, 1514 };
+	unsigned     _size_idx { 0 };
+
+	Phase    _phase       { Phase::ARP };
+	uint16_t _seq_base    { 0 };  /* sequence number of first request of phase */
+	unsigned _count       { 0 };  /* requests of the phase */
+	unsigned _sent        { 0 };
+	unsigned _replies     { 0 };
+	unsigned _lost        { 0 };
+	uint64_t _phase_start { 0 };
+	uint64_t _progress    { 0 };  /* time of last reply or send */
+
+	uint64_t _sent_us[MAX_REQUESTS]    { };
+	bool     _answered[MAX_REQUESTS]   { };
+	uint64_t _rtt_us[LATENCY_SAMPLES]  { };
+	unsigned _samples      { 0 };
+	unsigned _latency_lost { 0 };
+
+	Signal_handler<Main> _nic_handler { _env.ep(), *this, &Main::_handle_nic };
+
+	Timer::Periodic_timeout<Main> _tick {
+		_timer, *this, &Main::_handle_tick, Microseconds(50 * 1000) };
+
+	uint64_t _now_us() { return _timer.curr_time().trunc_to_plain_us().value; }
+
+	size_t _frame_size() const { return _sizes[_size_idx]; }
+
+	unsigned _in_flight() const { return _sent - _replies - _lost; }
+
+	/**
+	 * Submit a packet of 'size' bytes written by 'fn'
+	 *
+	 * \return  false if the packet could not be allocated or submitted
+	 */
+	template <typename FN>
+	bool _send(size_t const size, FN const &fn)
+	{
+		Nic::Session::Tx::Source &tx = *_nic.tx();
+
+		if (!tx.ready_to_submit()) return false;
+
+		try {
+			Nic::Packet_descriptor const pkt = tx.alloc_packet(size);
+			Size_guard size_guard(size);
+			fn(tx.packet_content(pkt), size_guard);
+			tx.submit_packet(pkt);
+			return true;
+		}
+		catch (Nic::Session::Tx::Source::Packet_alloc_failed) { return false; }
+	}
+
+	void _send_arp(Arp_packet::Opcode const opcode, Mac_address const &dst_mac,
+	               Ipv4_address const &dst_ip)
+	{
+		_send(sizeof(Ethernet_frame) + sizeof(Arp_packet),
+		      [&] (void *base, Size_guard &size_guard) {
+
+			Ethernet_frame &eth = Ethernet_frame::construct_at(base, size_guard);
+			eth.dst(opcode == Arp_packet::REQUEST ? Ethernet_frame::broadcast() : dst_mac);
+			eth.src(_mac);
+			eth.type(Ethernet_frame::Type::ARP);
+
+			Arp_packet &arp = eth.construct_at_data<Arp_packet>(size_guard);
+			arp.hardware_address_type(Arp_packet::ETHERNET);
+			arp.protocol_address_type(Arp_packet::IPV4);
+			arp.hardware_address_size(sizeof(Mac_address));
+			arp.protocol_address_size(sizeof(Ipv4_address));
+			arp.opcode(opcode);
+			arp.src_mac(_mac);
+			arp.src_ip(_ip);
+			arp.dst_mac(dst_mac);
+			arp.dst_ip(dst_ip);
+		});
+	}
+
+	bool _send_echo_request()
+	{
+		size_t   const size = _frame_size();
+		uint16_t const seq  = (uint16_t)(_seq_base + _sent);
+
+		bool const sent = _send(size, [&] (void *base, Size_guard &size_guard) {
+
+			Ethernet_frame &eth = Ethernet_frame::construct_at(base, size_guard);
+			eth.dst(_gw_mac);
+			eth.src(_mac);
+			eth.type(Ethernet_frame::Type::IPV4);
+
+			size_t const data_size = size - HEADER_SIZE;
+
+			Ipv4_packet &ip = eth.construct_at_data<Ipv4_packet>(size_guard);
+			ip.header_length(sizeof(Ipv4_packet) / 4);
+			ip.version(4);
+			ip.diff_service(0);
+			ip.ecn(0);
+			ip.identification(0);
+			ip.flags(0);
+			ip.fragment_offset(0);
+			ip.time_to_live(64);
+			ip.protocol(Ipv4_packet::Protocol::ICMP);
+			ip.src(_ip);
+			ip.dst(_target);
+			ip.total_length(sizeof(Ipv4_packet) + sizeof(Icmp_packet) + data_size);
+			ip.update_checksum();
+
+			Icmp_packet &icmp = ip.construct_at_data<Icmp_packet>(size_guard);
+			icmp.type(Icmp_packet::Type::ECHO_REQUEST);
+			icmp.code(Icmp_packet::Code::ECHO_REQUEST);
+			icmp.query_id(ICMP_ID);
+			icmp.query_seq(seq);
+
+			size_guard.consume_head(data_size);
+			char * const data = (char *)&icmp + sizeof(Icmp_packet);
+			for (size_t i = 0; i < data_size; i++)
+				data[i] = (char)('a' + i % 23);
+
+			icmp.update_checksum(data_size);
+		});
+
+		if (!sent) return false;
+
+		_sent_us[_sent] = _progress = _now_us();
+		_sent++;
+		return true;
+	}
+
+	void _handle_echo_reply(uint16_t const seq)
+	{
+		unsigned const index = (uint16_t)(seq - _seq_base);
+
+		/* reply of a previous phase or to a request accounted as lost */
+		if (index >= _sent || _answered[index]) return;
+
+		_answered[index] = true;
+		_replies++;
+
+		_progress = _now_us();
+
+		if (_phase == Phase::LATENCY && _samples < LATENCY_SAMPLES)
+			_rtt_us[_samples++] = _progress - _sent_us[index];
+	}
+
+	void _handle_frame(void *base, size_t const size)
+	{
+		Size_guard size_guard(size);
+
+		Ethernet_frame &eth = Ethernet_frame::cast_from(base, size_guard);
+
+		if (eth.type() == Ethernet_frame::Type::ARP) {
+			Arp_packet &arp = eth.data<Arp_packet>(size_guard);
+
+			if (!arp.ethernet_ipv4() || arp.dst_ip() != _ip) return;
+
+			if (arp.opcode() == Arp_packet::REQUEST)
+				_send_arp(Arp_packet::REPLY, arp.src_mac(), arp.src_ip());
+
+			if (arp.opcode() == Arp_packet::REPLY && _phase == Phase::ARP
+			 && arp.src_ip() == _gateway) {
+				_gw_mac = arp.src_mac();
+				_start_phase(Phase::LATENCY);
+			}
+			return;
+		}
+
+		if (eth.type() != Ethernet_frame::Type::IPV4) return;
+
+		Ipv4_packet &ip = eth.data<Ipv4_packet>(size_guard);
+		if (ip.protocol() != Ipv4_packet::Protocol::ICMP || ip.src() != _target)
+			return;
+
+		Icmp_packet &icmp = ip.data<Icmp_packet>(size_guard);
+		if (icmp.type() == Icmp_packet::Type::ECHO_REPLY && icmp.query_id() == ICMP_ID)
+			_handle_echo_reply(icmp.query_seq());
+	}
+
+	void _start_phase(Phase const phase)
+	{
+		_seq_base = (uint16_t)(_seq_base + _sent);
+		_phase    = phase;
+		_count    = (phase == Phase::LATENCY) ? (unsigned)LATENCY_SAMPLES : _requests;
+		_sent     = _replies = _lost = 0;
+
+		if (phase == Phase::LATENCY)
+			_samples = 0;
+
+		for (bool &answered : _answered) answered = false;
+
+		_phase_start = _progress = _now_us();
+	}
+
+	static void _sort(uint64_t *values, unsigned const count)
+	{
+		for (unsigned i = 1; i < count; i++)
+			for (unsigned j = i; j && values[j - 1] > values[j]; j--) {
+				uint64_t const v = values[j];
+				values[j]     = values[j - 1];
+				values[j - 1] = v;
+			}
+	}
+
+	uint64_t _percentile(unsigned const percent) const
+	{
+		return _samples ? _rtt_us[min((_samples * percent) / 100, _samples - 1)] : 0;
+	}
+
+	void _report(uint64_t const duration_us, unsigned const latency_lost)
+	{
+		_sort(_rtt_us, _samples);
+
+		uint64_t const us   = max(duration_us, (uint64_t)1);
+		uint64_t const pps  = (uint64_t)_replies * 1000 * 1000 / us;
+		uint64_t const kbit = (uint64_t)_replies * _frame_size() * 8 * 1000 / us;
+
+		log("<result size=\"", _frame_size(), "\""
+		    " requests=\"", _sent, "\" lost=\"", _lost + latency_lost, "\""
+		    " pps=\"", pps, "\" kbit_per_s=\"", kbit, "\""
+		    " rtt_p50_us=\"", _percentile(50), "\""
+		    " rtt_p90_us=\"", _percentile(90), "\""
+		    " rtt_p99_us=\"", _percentile(99), "\""
+		    " rtt_max_us=\"", _samples ? _rtt_us[_samples - 1] : 0, "\"/>");
+	}
+
+	void _finish_phase()
+	{
+		if (_phase == Phase::LATENCY) {
+			_latency_lost = _lost;
+			_start_phase(Phase::THROUGHPUT);
+			return;
+		}
+
+		_report(_progress - _phase_start, _latency_lost);
+
+		if (++_size_idx == sizeof(_sizes) / sizeof(_sizes[0])) {
+			_phase = Phase::DONE;
+			log("--- NIC benchmark finished ---");
+			return;
+		}
+
+		_start_phase(Phase::LATENCY);
+	}
+
+	void _send_requests()
+	{
+		if (_phase != Phase::LATENCY && _phase != Phase::THROUGHPUT)
+			return;
+
+		unsigned const window = (_phase == Phase::LATENCY) ? 1 : _window;
+
+		while (_sent < _count && _in_flight() < window)
+			if (!_send_echo_request()) break;
+
+		if (_sent == _count && _in_flight() == 0)
+			_finish_phase();
+	}
+
+	void _handle_nic()
+	{
+		Nic::Session::Tx::Source &tx = *_nic.tx();
+		Nic::Session::Rx::Sink   &rx = *_nic.rx();
+
+		while (tx.ack_avail())
+			tx.release_packet(tx.get_acked_packet());
+
+		while (rx.packet_avail() && rx.ready_to_ack()) {
+			Nic::Packet_descriptor const pkt = rx.get_packet();
+
+			if (pkt.size() && rx.packet_valid(pkt)) {
+				try { _handle_frame(rx.packet_content(pkt), pkt.size()); }
+				catch (Size_guard::Exceeded) { }
+			}
+
+			rx.acknowledge_packet(pkt);
+		}
+
+		_send_requests();
+	}
+
+	void _handle_tick(Duration)
+	{
+		uint64_t const now = _now_us();
+
+		if (_phase == Phase::ARP) {
+			_send_arp(Arp_packet::REQUEST, Mac_address(), _gateway);
+			return;
+		}
+
+		if (_phase == Phase::DONE || now - _progress < _timeout_us)
+			return;
+
+		/* no progress, account requests in flight as lost */
+		for (unsigned i = 0; i < _sent; i++)
+			if (!_answered[i]) {
+				_answered[i] = true;
+				_lost++;
+			}
+
+		_progress = now;
+
+		_send_requests();
+	}
+
+	Main(Env &env) : _env(env)
+	{
+		_nic.rx_channel()->sigh_ready_to_ack(_nic_handler);
+		_nic.rx_channel()->sigh_packet_avail(_nic_handler);
+		_nic.tx_channel()->sigh_ack_avail(_nic_handler);
+		_nic.tx_channel()->sigh_ready_to_submit(_nic_handler);
+
+		log("ip=", _ip, " gateway=", _gateway, " target=", _target,
+		    " requests=", _requests, " window=", _window);
+	}
+};
+
+
+void Component::construct(Genode::Env &env)
+{
+	log("--- NIC benchmark --");
+
+	static Test::Main main(env);
+}
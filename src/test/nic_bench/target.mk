@@ -0,0 +1,5 @@
+TARGET = test-nic_bench
+SRC_CC = main.cc
+LIBS   = base net
+
+vpath %.cc $(PRG_DIR)
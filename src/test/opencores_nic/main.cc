@@ -0,0 +1,630 @@
+/*
+ * \brief  Test of the OpenCores NIC driver against a model of the device
+ * \author agent
+ * \date   2026-10-16
+ *
+ * The driver core ('Opencores' and 'Phy') operates on a register window and
+ * a DMA window backed by RAM. A simple model of the ethoc descriptor engine
+ * consumes TX descriptors and fills RX descriptors, and a register file
+ * stands in for the PHY behind the management interface. Besides checking
+ * ring handling, statistics, address filter, and link resolution.
+ */
+
+/*
+ * Copyright (C) 2026 Genode Labs GmbH
+ *
+ * This file is part of the Genode OS framework, which is distributed
+ * under the terms of the GNU Affero General Public License version 3.
+ */
+
+#include <base/attached_ram_dataspace.h>
+#include <base/component.h>
+#include <base/log.h>
+
+/* local includes */
+#include <opencores.h>
+#include <phy.h>
+
+using namespace Genode;
+
+namespace Test {
+	struct Ethoc_model;
+	struct Phy_model;
+	struct Failed : Exception { };
+	struct Main;
+}
+
+
+/*
+ * Descriptor engine of the device
+ *
+ * The interrupt-source register is write-one-to-clear on the device, which
+ * the model emulates by 'ack_irq' after the driver wrote back the sources.
+ */
+struct Test::Ethoc_model : Mmio<Opencores::MMIO_SIZE>
+{
+	using Tx         = Opencores::Tx_descriptor;
+	using Rx         = Opencores::Rx_descriptor;
+	using Int_source = Opencores::Int_source;
+
+	Opencores::Dma_window const _dma;
+
+	unsigned _tx { 0 };
+	unsigned _rx { 0 };
+
+	Ethoc_model(Byte_range_ptr const &range, Opencores::Dma_window const &dma)
+	:
+		Mmio(range), _dma(dma)
+	{ }
+
+	void *_buffer(uint32_t const dma_addr)
+	{
+		return (void *)(_dma.local_addr + (dma_addr - _dma.dma_addr));
+	}
+
+	unsigned _tx_count() const { return read<Opencores::Tx_bd::Num>(); }
+
+	/* status bits reported for the next transmitted frame */
+	Tx::access_t tx_status { 0 };
+
+	/* transmitted descriptors that requested a completion interrupt */
+	unsigned tx_irqs { 0 };
+
+	/**
+	 * Transmit up to 'max' frames handed over by the driver
+	 *
+	 * \return  number of transmitted frames
+	 */
+	template <typename FN>
+	unsigned transmit(unsigned const max, FN const &fn)
+	{
+		unsigned count = 0;
+
+		for (; count < max; count++) {
+			Tx::access_t descr = read<Tx>(_tx);
+
+			if (!Tx::Rd::get(descr)) break;
+
+			fn(_buffer((uint32_t)Tx::Txpnt::get(descr)), (size_t)Tx::Len::get(descr));
+
+			Tx::Rd::set(descr, 0);
+			descr |= tx_status;
+			tx_status = 0;
+			write<Tx>(descr, _tx);
+
+			if (Tx::Irq::get(descr)) {
+				tx_irqs++;
+				if (Tx::error(descr)) write<Int_source::Txe>(1);
+				else                  write<Int_source::Txb>(1);
+			}
+
+			_tx = (Tx::Wr::get(descr) || _tx + 1 == _tx_count()) ? 0 : _tx + 1;
+		}
+
+		return count;
+	}
+
+	/**
+	 * Receive a frame into the next empty RX descriptor
+	 *
+	 * \return  false if the frame was dropped because of a full ring
+	 */
+	bool receive(void const *frame, size_t const length, Rx::access_t const status = 0)
+	{
+		unsigned const slot = _tx_count() + _rx;
+
+		Rx::access_t descr = read<Rx>(slot);
+
+		if (!Rx::E::get(descr)) {
+			write<Int_source::Busy>(1);
+			return false;
+		}
+
+		memcpy(_buffer((uint32_t)Rx::Rxpnt::get(descr)), frame, length);
+
+		Rx::E::set(descr, 0);
+		Rx::Len::set(descr, length);
+		descr |= status;
+		write<Rx>(descr, slot);
+
+		if (Rx::Irq::get(descr))
+			write<Int_source::Rxb>(1);
+
+		_rx = (Rx::Wr::get(descr) || slot + 1 == Opencores::Geometry::MAX_DESCRIPTORS)
+		    ? 0 : _rx + 1;
+
+		return true;
+	}
+
+	void ack_irq() { write<Int_source>(0); }
+
+	/* soft resets performed by 'clock' */
+	unsigned resets { 0 };
+
+	/**
+	 * Advance the device, called whenever the driver waits
+	 *
+	 * While the reset bit is set, the registers return to their defaults
+	 * and the descriptor pointers to the start of the rings, like the
+	 * 'open_eth_reset' function of Qemu.
+	 */
+	void clock()
+	{
+		using Moder = Opencores::Moder;
+
+		if (!read<Moder::Rst>()) return;
+
+		write<Moder>(Moder::Rst::bits(1) | 0xa000);
+		write<Int_source>(0);
+		write<Opencores::Int_mask>(0);
+		write<Opencores::Ipgt>(0x12);
+		write<Opencores::Tx_bd>(0x40);
+		write<Opencores::Miimoder>(0x64);
+		write<Opencores::Miiaddress>(0);
+		write<Opencores::Hash>(0, 0);
+		write<Opencores::Hash>(0, 1);
+
+		for (unsigned i = 0; i < 6; i++)
+			write<Opencores::Mac_addr>(0, i);
+
+		_tx = _rx = 0;
+		resets++;
+	}
+};
+
+
+/*
+ * Register file of the PHY, the link partner is configured by the test
+ */
+struct Test::Phy_model : Mdio
+{
+	uint16_t regs[32] { };
+
+	bool     preamble       { false };
+	unsigned preamble_reads { 0 };
+
+	uint16_t mdio_read(unsigned const reg) override
+	{
+		if (preamble) preamble_reads++;
+		return regs[reg & 0x1f];
+	}
+
+	void mdio_write(unsigned const reg, uint16_t value) override
+	{
+		/* reset completes immediately */
+		if (reg == Phy::BMCR)
+			value &= (uint16_t)~Phy::BMCR_RESET;
+
+		regs[reg & 0x1f] = value;
+	}
+
+	void mdio_preamble(bool const enabled) override { preamble = enabled; }
+
+	unsigned read_reg { 0 };
+
+	bool mdio_read_start(unsigned const reg) override
+	{
+		read_reg = reg & 0x1f;
+		return true;
+	}
+
+	bool mdio_read_complete(uint16_t &value) override
+	{
+		value = regs[read_reg];
+		return true;
+	}
+
+	void link(bool const up, bool const an_complete, uint16_t const partner)
+	{
+		regs[Phy::BMSR]   = (uint16_t)((up ? Phy::BMSR_LINK_STATUS : 0)
+		                             | (an_complete ? Phy::BMSR_AN_COMPLETE : 0));
+		regs[Phy::ANLPAR] = partner;
+	}
+};
+
+
+struct Test::Main
+{
+	enum { DMA_BASE = 0x10000000 };
+
+	/*
+	 * The model advances whenever the driver waits
+	 */
+	struct Model_delayer : Mmio<0>::Delayer
+	{
+		Ethoc_model &model;
+
+		Model_delayer(Ethoc_model &model) : model(model) { }
+
+		void usleep(uint64_t) override { model.clock(); }
+	};
+
+	Env &_env;
+
+	Opencores::Geometry const _geometry { .tx = 16, .rx = 8, .stride = 0x800 };
+
+	Attached_ram_dataspace _regs { _env.ram(), _env.rm(), 0x1000 };
+	Attached_ram_dataspace _dma  { _env.ram(), _env.rm(), _geometry.dma_size() };
+
+	Opencores::Dma_window const _window {
+		.local_addr       = (addr_t)_dma.local_addr<void>(),
+		.dma_addr         = DMA_BASE,
+		.size             = _geometry.dma_size(),
+		.cached           = false,
+		.cache_block_size = 0 };
+
+	Net::Mac_address const _mac { 0x2 };
+
+	Byte_range_ptr _range() { return { _regs.local_addr<char>(), Opencores::MMIO_SIZE }; }
+
+	Ethoc_model _model { _range(), _window };
+
+	Model_delayer _delayer { _model };
+
+	Opencores _nic { _range(), _window, _mac, 1, _geometry,
+	                 { .promiscuous = false, .hash = { 0, 0 } }, _delayer };
+
+	char _frame[Opencores::Geometry::MAX_FRAME] { };
+
+	static void _check(bool const condition, char const *what)
+	{
+		if (condition) return;
+
+		error("check failed: ", what);
+		throw Failed();
+	}
+
+	void _fill_frame(unsigned const seq, size_t const length)
+	{
+		for (size_t i = 0; i < length; i++)
+			_frame[i] = (char)(seq + i);
+	}
+
+	static Net::Mac_address _mac_address(uint8_t const (&octets)[6])
+	{
+		Net::Mac_address mac { };
+		for (unsigned i = 0; i < 6; i++)
+			mac.addr[i] = octets[i];
+
+		return mac;
+	}
+
+	static bool _frame_valid(void const *frame, unsigned const seq, size_t const length)
+	{
+		char const * const data = (char const *)frame;
+
+		for (size_t i = 0; i < length; i++)
+			if (data[i] != (char)(seq + i)) return false;
+
+		return true;
+	}
+
+	void _test_init()
+	{
+		using Tx = Opencores::Tx_descriptor;
+		using Rx = Opencores::Rx_descriptor;
+
+		_check(_model.read<Opencores::Tx_bd::Num>() == _geometry.tx, "TX descriptor count");
+		_check(_model.read<Opencores::Moder::TxEn>() && _model.read<Opencores::Moder::RxEn>(),
+		       "TX/RX enabled");
+		_check(!_model.read<Opencores::Moder::Bro>(), "broadcasts accepted");
+		_check(_model.read<Opencores::Mac_addr>(5) == _mac.addr[0], "MAC byte order");
+
+		_check(_model.read<Tx::Wr>(_geometry.tx - 1) && !_model.read<Tx::Wr>(0),
+		       "TX wrap bit");
+
+		unsigned const last_rx = _geometry.tx + _geometry.rx - 1;
+		_check(_model.read<Rx::Wr>(last_rx) && _model.read<Rx::E>(last_rx), "RX wrap bit");
+		_check(_model.read<Rx::Rxpnt>(last_rx)
+		       == DMA_BASE + last_rx * _geometry.stride, "RX buffer address");
+	}
+
+	void _test_transmit()
+	{
+		unsigned seq = 0;
+
+		/* three passes over the ring to exercise the wrap-around */
+		for (unsigned pass = 0; pass < 3; pass++) {
+
+			unsigned sent  = 0;
+			unsigned const first = _nic.tx_slot();
+			for (;; sent++) {
+				_fill_frame(seq + sent, 60 + sent);
+				if (!_nic.transmit(_frame, 60 + sent)) break;
+			}
+
+			_check(sent == _geometry.tx && _nic.tx_ring_full(), "TX backpressure");
+
+			unsigned checked = 0;
+			auto check_fn = [&] (void const *frame, size_t length)
+			{
+				_check(length == 60 + checked, "TX frame length");
+				_check(_frame_valid(frame, seq + checked, length), "TX frame content");
+				checked++;
+			};
+
+			_check(_model.transmit(~0u, check_fn) == sent, "TX frames consumed by device");
+			/* descriptors are reclaimed in the order of submission */
+			unsigned reclaimed = 0;
+			_nic.reclaim_transmitted([&] (unsigned const index) {
+				_check(index == (first + reclaimed) % _geometry.tx, "TX reclaim order");
+				reclaimed++; });
+
+			_check(reclaimed == sent && !_nic.tx_ring_used(), "TX reclaim");
+
+			seq += sent;
+		}
+
+		/* completion interrupt and error accounting */
+		_nic.transmit(_frame, 100);
+		_nic.transmit(_frame, 100);
+		_model.tx_status = Opencores::Tx_descriptor::Ur::bits(1);
+		_model.transmit(~0u, [] (void const *, size_t) { });
+
+		unsigned reclaimed = 0;
+		_nic.with_irq([&] { reclaimed = _nic.reclaim_transmitted(); }, [] { });
+		_model.ack_irq();
+
+		Opencores::Statistics const &stats = _nic.statistics();
+		_check(reclaimed == 2, "TX completion via interrupt");
+		_check(stats.tx_packets == 3 * _geometry.tx + 1, "TX packet count");
+		_check(stats.tx_underruns == 1, "TX underrun count");
+		_check(stats.tx_ring_high_water == _geometry.tx, "TX high-water mark");
+	}
+
+	void _test_tx_irq()
+	{
+		auto transmit = [&] (unsigned const frames, unsigned const interval,
+		                     bool const batch_end)
+		{
+			_nic.tx_irq_interval(interval);
+			_model.tx_irqs = 0;
+
+			for (unsigned i = 0; i < frames; i++)
+				_nic.transmit(_frame, 64, !batch_end || i + 1 < frames);
+
+			_model.transmit(~0u, [] (void const *, size_t) { });
+
+			unsigned reclaimed = 0;
+			_nic.with_irq([&] { reclaimed = _nic.reclaim_transmitted(); }, [] { });
+			_model.ack_irq();
+
+			_check(reclaimed == frames, "TX batch reclaimed");
+		};
+
+		/* every fourth frame and the last frame of the batch */
+		transmit(10, 4, true);
+		_check(_model.tx_irqs == 3, "TX interrupts per interval and batch end");
+
+		/* the frame that fills the ring, although the batch continues */
+		transmit(_geometry.tx, ~0u, false);
+		_check(_model.tx_irqs == 1, "TX interrupt on full ring");
+
+		/* a single frame that may be followed by more stays staged until flushed */
+		_model.tx_irqs = 0;
+		_nic.transmit(_frame, 64, true);
+		_check(_model.transmit(~0u, [] (void const *, size_t) { }) == 0
+		       && _nic.tx_ring_used() == 1, "TX frame staged");
+
+		_nic.flush_transmit();
+		_check(_model.transmit(~0u, [] (void const *, size_t) { }) == 1
+		       && _model.tx_irqs == 1, "TX interrupt for single frame");
+
+		unsigned reclaimed = 0;
+		_nic.with_irq([&] { reclaimed = _nic.reclaim_transmitted(); }, [] { });
+		_model.ack_irq();
+		_check(reclaimed == 1, "TX single frame reclaimed");
+
+		_nic.tx_irq_interval(1);
+	}
+
+	void _test_reset()
+	{
+		using Tx = Opencores::Tx_descriptor;
+
+		Opencores::Statistics const &stats = _nic.statistics();
+
+		/* stalled device, frames stay pending */
+		for (unsigned i = 0; i < 5; i++)
+			_nic.transmit(_frame, 64);
+
+		_model.receive(_frame, 64);
+
+		_check(_nic.reclaim_transmitted() == 0 && _nic.tx_ring_used() == 5,
+		       "TX ring stuck");
+
+		using Moder    = Opencores::Moder;
+		using Int_mask = Opencores::Int_mask;
+		using Ipgt     = Opencores::Ipgt;
+		using Hash     = Opencores::Hash;
+
+		Moder::access_t    const moder    = _model.read<Moder>();
+		Int_mask::access_t const int_mask = _model.read<Int_mask>();
+		Ipgt::access_t     const ipgt     = _model.read<Ipgt>();
+		Hash::access_t     const hash     = _model.read<Hash>(1);
+
+		_nic.reset_rings();
+
+		_check(_model.resets == 1 && !_model._tx && !_model._rx,
+		       "descriptor pointers reset by soft reset");
+		_check(_model.read<Moder>() == moder && _model.read<Int_mask>() == int_mask
+		       && _model.read<Ipgt>() == ipgt && _model.read<Hash>(1) == hash
+		       && _model.read<Opencores::Tx_bd::Num>() == _geometry.tx
+		       && _model.read<Opencores::Mac_addr>(0) == _mac.addr[5]
+		       && _model.read<Opencores::Miiaddress::Fiad>() == 1,
+		       "MAC configuration restored");
+
+		_check(!_nic.tx_ring_used() && stats.tx_resets == 1 && stats.tx_dropped == 5,
+		       "TX ring reset");
+		_check(!_model.read<Tx::Rd>(0) && _model.read<Tx::Wr>(_geometry.tx - 1),
+		       "TX descriptors reset");
+		_check(!_nic.with_received_frame([] (void const *, size_t) { }), "RX ring reset");
+
+		/* rings resume at the first descriptor */
+		unsigned const packets = (unsigned)stats.tx_packets;
+		_fill_frame(7, 80);
+		_nic.transmit(_frame, 80);
+
+		unsigned sent = 0;
+		_model.transmit(~0u, [&] (void const *frame, size_t length) {
+			_check(length == 80 && _frame_valid(frame, 7, length), "TX after reset");
+			sent++;
+		});
+
+		_check(sent == 1 && _nic.reclaim_transmitted() == 1
+		       && stats.tx_packets == packets + 1, "TX completion after reset");
+		_model.ack_irq();
+	}
+
+	void _test_receive()
+	{
+		unsigned seq = 0;
+
+		for (unsigned pass = 0; pass < 3; pass++) {
+
+			unsigned injected = 0;
+			for (;; injected++) {
+				_fill_frame(seq + injected, 64 + injected);
+				if (!_model.receive(_frame, 64 + injected)) break;
+			}
+
+			_check(injected == _geometry.rx, "RX ring full");
+
+			unsigned harvested = 0;
+			auto check_fn = [&] (void const *frame, size_t length)
+			{
+				_check(length == 64 + harvested, "RX frame length");
+				_check(_frame_valid(frame, seq + harvested, length), "RX frame content");
+			};
+
+			_nic.with_irq([] { }, [&] {
+				while (_nic.with_received_frame(check_fn))
+					harvested++;
+			});
+			_model.ack_irq();
+
+			_check(harvested == injected, "RX frames harvested");
+
+			seq += injected;
+		}
+
+		using Rx = Opencores::Rx_descriptor;
+
+		_model.receive(_frame, 64, Rx::Crc::bits(1));
+		_check(_nic.with_received_frame([] (void const *, size_t) { }), "RX frame pending");
+
+		/* the descriptor is returned from its shadow, without stale status */
+		Rx::access_t const descr = _model.read<Rx>(_geometry.tx);
+		_check(Rx::E::get(descr) && !Rx::Crc::get(descr) && !Rx::Len::get(descr)
+		       && Rx::Rxpnt::get(descr) == DMA_BASE + _geometry.tx * _geometry.stride,
+		       "RX descriptor returned");
+
+		Opencores::Statistics const &stats = _nic.statistics();
+		_check(stats.rx_packets == 3 * _geometry.rx + 1, "RX packet count");
+		_check(stats.rx_busy == 3, "RX busy count");
+		_check(stats.rx_errors == 1, "RX error count");
+
+		/* frames dropped while polling */
+		while (_model.receive(_frame, 64));
+		_nic.update_rx_busy();
+		_model.ack_irq();
+		_check(stats.rx_busy == 4, "RX busy count while polling");
+
+		unsigned drained = 0;
+		while (_nic.with_received_frame([] (void const *, size_t) { }))
+			drained++;
+
+		_check(drained == _geometry.rx, "RX ring drained");
+	}
+
+	void _test_filter()
+	{
+		Opencores::Filter filter { .promiscuous = false, .hash = { 0, 0 } };
+
+		/* all-hosts group hashes to bit 31 */
+		filter.add_multicast(_mac_address({ 0x01, 0x00, 0x5e, 0x00, 0x00, 0x01 }));
+
+		/* IPv6 all-nodes group hashes to bit 62 */
+		filter.add_multicast(_mac_address({ 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 }));
+
+		_nic.configure_filter(filter);
+
+		_check(_model.read<Opencores::Hash>(0) == 1u << 31, "hash of all-hosts group");
+		_check(_model.read<Opencores::Hash>(1) == 1u << 30, "hash of all-nodes group");
+		_check(!_model.read<Opencores::Moder::Pro>(), "promiscuous mode off");
+	}
+
+	void _test_phy()
+	{
+		Phy_model autoneg_model { };
+		Phy       autoneg { autoneg_model, true };
+
+		_check(autoneg_model.preamble_reads == 1, "preamble after PHY reset");
+		_check(autoneg_model.regs[Phy::MICR] & 1, "PHY interrupt output");
+		_check(autoneg_model.regs[Phy::BMCR] == (Phy::BMCR_AN_ENABLE | Phy::BMCR_RESTART_AN),
+		       "auto-negotiation started");
+
+		autoneg_model.link(false, false, 0);
+		_check(!autoneg.link_state().up, "link down");
+
+		autoneg_model.link(true, false, Phy::AN_100_FULL);
+		_check(!autoneg.link_state().up, "link down until negotiation completed");
+
+		autoneg_model.link(true, true, Phy::AN_CSMA | Phy::AN_10_FULL | Phy::AN_100_HALF);
+		Phy::Link const half = autoneg.link_state();
+		_check(half.up && half.speed == 100 && !half.full_duplex, "resolved 100 Mbit/s half duplex");
+
+		_nic.configure_link(half);
+		_check(!_model.read<Opencores::Moder::Fulld>(), "MAC half duplex");
+		_check(_model.read<Opencores::Ipgt>() == 0x12, "half-duplex packet gap");
+
+		autoneg_model.link(true, true, Phy::AN_10_HALF | Phy::AN_10_FULL | Phy::AN_100_FULL);
+		Phy::Link const full = autoneg.link_state();
+		_check(full.up && full.speed == 100 && full.full_duplex, "resolved 100 Mbit/s full duplex");
+
+		_nic.configure_link(full);
+		_check(_model.read<Opencores::Moder::Fulld>(), "MAC full duplex");
+		_check(_model.read<Opencores::Ipgt>() == 0x15, "full-duplex packet gap");
+
+		/* the non-blocking poll collects the BMSR read started by the previous poll */
+		_check(!autoneg.link_changed(full) && !autoneg.link_changed(full),
+		       "link unchanged");
+
+		autoneg_model.link(false, false, 0);
+		_check(autoneg.link_changed(full), "link loss detected by poll");
+		_check(!autoneg.link_state().up, "link down after poll");
+
+		Phy_model forced_model { };
+		Phy       forced { forced_model, false };
+
+		forced_model.link(true, false, 0);
+		Phy::Link const link = forced.link_state();
+		_check(link.up && link.speed == 100 && link.full_duplex, "forced 100 Mbit/s full duplex");
+	}
+
+	Main(Env &env) : _env(env)
+	{
+		try {
+			_test_init();
+			_test_transmit();
+			_test_tx_irq();
+			_test_reset();
+			_test_receive();
+			_test_filter();
+			_test_phy();
+		} catch (Failed) {
+			log("Test failed");
+			return;
+		}
+
+		log("Test successful");
+	}
+};
+
+
+void Component::construct(Genode::Env &env)
+{
+	log("--- OpenCores NIC model test --");
+
+	static Test::Main main(env);
+}